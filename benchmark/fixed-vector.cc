@@ -0,0 +1,100 @@
+#include <pinyon.hh>
+
+/*
+
+Compare std::vector against the fixed capacity A<>::Array containers,
+on state copies and on bandit select/update, which are the hot paths of every search iteration.
+
+*/
+
+const size_t max_actions = 4;
+const size_t n_actions = 3;
+const size_t repetitions = 1 << 20;
+
+template <typename F>
+double time_ns(F &&f)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+    f();
+    const auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / repetitions;
+}
+
+template <typename Types>
+void benchmark_state_copy(const typename Types::State &state, const std::string &name)
+{
+    typename Types::PRNG device{0};
+    size_t sink = 0;
+    const double ns = time_ns(
+        [&]()
+        {
+            for (size_t i = 0; i < repetitions; ++i)
+            {
+                typename Types::State state_copy = state;
+                state_copy.randomize_transition(device);
+                sink += state_copy.row_actions.size();
+            }
+        });
+    std::cout << name << " state copy: " << ns << " ns (" << sink << ")" << std::endl;
+}
+
+template <typename Types>
+void benchmark_bandit(const std::string &name)
+{
+    typename Types::PRNG device{0};
+    typename Types::BanditAlgorithm bandit{};
+    typename Types::MatrixStats stats{};
+    typename Types::ModelOutput model_output{};
+    bandit.expand(stats, n_actions, n_actions, model_output);
+    typename Types::Outcome outcome{};
+    const double ns = time_ns(
+        [&]()
+        {
+            for (size_t i = 0; i < repetitions; ++i)
+            {
+                bandit.select(device, stats, outcome);
+                const double x = device.uniform();
+                outcome.value = typename Types::Value{x, 1 - x};
+                bandit.update_matrix_stats(stats, outcome);
+            }
+        });
+    std::cout << name << " " << bandit << " select/update: " << ns << " ns" << std::endl;
+}
+
+template <typename Types>
+void benchmark_search(const std::string &name)
+{
+    typename Types::PRNG device{0};
+    typename Types::State state{n_actions, 10};
+    typename Types::Model model{0};
+    typename Types::MatrixNode root{};
+    typename Types::Search search{};
+    const size_t iterations = 1 << 16;
+    const size_t ms = search.run_for_iterations(iterations, device, state, model, root);
+    std::cout << name << " " << search << " : " << iterations << " iterations in " << ms << " ms" << std::endl;
+}
+
+int main()
+{
+    using MoldVector = MonteCarloModel<MoldState<SimpleTypes>>;
+    using MoldArray = MonteCarloModel<MoldState<SimpleArrayTypes<max_actions>>>;
+    benchmark_state_copy<MoldVector>(MoldVector::State{n_actions, 10}, "MoldState std::vector");
+    benchmark_state_copy<MoldArray>(MoldArray::State{n_actions, 10}, "MoldState A::Array");
+
+    using TreeVector = MonteCarloModel<RandomTree<RandomTreeFloatTypes>>;
+    using TreeArray = MonteCarloModel<RandomTree<RandomTreeFloatArrayTypes<max_actions>>>;
+    benchmark_state_copy<TreeVector>(TreeVector::State{prng{0}, 10, n_actions, n_actions, 1}, "RandomTree std::vector");
+    benchmark_state_copy<TreeArray>(TreeArray::State{prng{0}, 10, n_actions, n_actions, 1}, "RandomTree A::Array");
+
+    benchmark_bandit<Exp3<MoldVector>>("std::vector");
+    benchmark_bandit<Exp3<MoldArray>>("A::Array");
+    benchmark_bandit<RMPlus<MoldVector>>("std::vector");
+    benchmark_bandit<RMPlus<MoldArray>>("A::Array");
+    benchmark_bandit<UCB<MoldVector>>("std::vector");
+    benchmark_bandit<UCB<MoldArray>>("A::Array");
+
+    benchmark_search<TreeBandit<Exp3<MoldVector>>>("std::vector");
+    benchmark_search<TreeBandit<Exp3<MoldArray>>>("A::Array");
+
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <pinyon.hh>
+
+/*
+
+Latency and throughput of InferenceServer against calling a batched model inline from every thread.
+
+The synthetic model busy waits `batch_us + items * item_us` per call, like a GPU model where the fixed cost of a call
+dominates. Inline, every request pays the fixed cost. Through the server, it is shared by the whole batch.
+
+usage: inference-server [threads] [requests per thread] [batch_us] [item_us] [max batch size] [timeout_us]
+
+*/
+
+using Clock = std::chrono::steady_clock;
+
+template <IsStateTypes Types>
+struct SyntheticBatchModel : Types
+{
+    struct ModelOutput
+    {
+        typename Types::Value value;
+    };
+    using ModelBatchInput = std::vector<typename Types::State>;
+    using ModelBatchOutput = std::vector<ModelOutput>;
+
+    class Model
+    {
+    public:
+        std::chrono::microseconds batch_cost;
+        std::chrono::microseconds item_cost;
+
+        Model(const size_t batch_us, const size_t item_us)
+            : batch_cost{batch_us}, item_cost{item_us}
+        {
+        }
+
+        void inference(
+            Types::State &&state,
+            ModelOutput &output) const
+        {
+            spin(batch_cost + item_cost);
+            output.value = make_draw<Types>();
+        }
+
+        void inference(
+            ModelBatchInput &batch_input,
+            ModelBatchOutput &batch_output) const
+        {
+            spin(batch_cost + item_cost * batch_input.size());
+            batch_output.resize(batch_input.size());
+            for (auto &output : batch_output)
+            {
+                output.value = make_draw<Types>();
+            }
+        }
+
+        void add_to_batch_input(
+            Types::State &&state,
+            ModelBatchInput &batch_input) const
+        {
+            batch_input.push_back(state);
+        }
+
+        void get_output(
+            ModelOutput &output,
+            ModelBatchOutput &batch_output,
+            const long int index) const
+        {
+            output = batch_output[index];
+        }
+
+    private:
+        static void spin(const std::chrono::microseconds duration)
+        {
+            const auto end = Clock::now() + duration;
+            while (Clock::now() < end)
+            {
+            }
+        }
+    };
+};
+
+using BatchTypes = SyntheticBatchModel<MoldState<>>;
+using ServerTypes = InferenceServer<BatchTypes>;
+
+static_assert(IsBatchModelTypes<BatchTypes>);
+static_assert(IsSingleModelTypes<ServerTypes>);
+
+template <typename Model>
+void benchmark(const std::string &name, Model &model, const size_t threads, const size_t requests)
+{
+    std::thread thread_pool[threads];
+    double latency_us[threads];
+    const auto start = Clock::now();
+    for (size_t t = 0; t < threads; ++t)
+    {
+        thread_pool[t] = std::thread(
+            [&model, requests, &latency_us, t]()
+            {
+                Model model_thread{model};
+                typename ServerTypes::ModelOutput output;
+                double total = 0;
+                for (size_t i = 0; i < requests; ++i)
+                {
+                    const auto request_start = Clock::now();
+                    model_thread.inference(ServerTypes::State{2, 10}, output);
+                    total += std::chrono::duration<double, std::micro>(Clock::now() - request_start).count();
+                }
+                latency_us[t] = total / requests;
+            });
+    }
+    double latency = 0;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        thread_pool[t].join();
+        latency += latency_us[t] / threads;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << name << ": " << threads * requests / seconds << " requests/s, mean latency " << latency << " us" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t threads = argc > 1 ? std::atoi(argv[1]) : 8;
+    const size_t requests = argc > 2 ? std::atoi(argv[2]) : 1 << 10;
+    const size_t batch_us = argc > 3 ? std::atoi(argv[3]) : 200;
+    const size_t item_us = argc > 4 ? std::atoi(argv[4]) : 5;
+    const size_t max_batch_size = argc > 5 ? std::atoi(argv[5]) : threads;
+    const size_t timeout_us = argc > 6 ? std::atoi(argv[6]) : 500;
+
+    std::cout << threads << " threads, " << requests << " requests each, batch cost " << batch_us
+              << " us, item cost " << item_us << " us" << std::endl;
+
+    BatchTypes::Model inline_model{batch_us, item_us};
+    benchmark("inline", inline_model, threads, requests);
+
+    ServerTypes::Model server_model{inline_model, max_batch_size, std::chrono::microseconds{timeout_us}};
+    benchmark("server", server_model, threads, requests);
+    std::cout << "mean batch size: " << static_cast<double>(server_model.server->get_items()) / server_model.server->get_batches()
+              << std::endl;
+
+    return 0;
+}
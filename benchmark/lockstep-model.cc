@@ -0,0 +1,42 @@
+#include <pinyon.hh>
+
+/*
+
+Rollouts per second of MonteCarloModel's batched inference against LockstepModel's,
+on HashRandomTree (where the lanes do the real transitions) and MoldState.
+
+*/
+
+const size_t batch_size = 1 << 10;
+const size_t batches = 1 << 6;
+
+template <typename Types>
+void benchmark_batches(const typename Types::State &state, const std::string &name)
+{
+    typename Types::Model model{prng{0}};
+    typename Types::ModelBatchOutput batch_output{};
+    double sink = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (size_t b = 0; b < batches; ++b)
+    {
+        typename Types::ModelBatchInput batch_input(batch_size, state);
+        model.inference(batch_input, batch_output);
+        sink += batch_output[0].value.get_row_value();
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << name << ": " << batch_size * batches / seconds << " rollouts/s (" << sink << ")" << std::endl;
+}
+
+int main()
+{
+    const HashRandomTree<>::State hash_tree{prng{0}, 20, 3, 3, 3};
+    benchmark_batches<MonteCarloModel<HashRandomTree<>>>(hash_tree, "MonteCarloModel<HashRandomTree>");
+    benchmark_batches<LockstepModel<HashRandomTree<>>>(hash_tree, "LockstepModel<HashRandomTree>");
+
+    const MoldState<>::State mold{3, 20};
+    benchmark_batches<MonteCarloModel<MoldState<>>>(mold, "MonteCarloModel<MoldState>");
+    benchmark_batches<LockstepModel<MoldState<>>>(mold, "LockstepModel<MoldState>");
+
+    return 0;
+}
@@ -40,6 +40,28 @@ void benchmark_mtp_(const size_t threads = 8, const size_t pool_size = 64)
     std::cout << search << " : " << root.count_matrix_nodes() << std::endl;
 }
 
+template <typename Types>
+void benchmark_flat_()
+{
+    typename Types::PRNG device{0};
+    typename Types::State state{max_actions, max_depth};
+    typename Types::Model model{0};
+    typename Types::Search search{};
+    search.run(duration_ms, device, state, model);
+    std::cout << search << " : " << search.matrix_data.size() << std::endl;
+}
+
+template <typename Types>
+void benchmark_mt_flat_(const size_t threads = 8, const size_t max_nodes = 1 << 20)
+{
+    typename Types::PRNG device{0};
+    typename Types::State state{max_actions, max_depth};
+    typename Types::Model model{0};
+    typename Types::Search search{typename Types::BanditAlgorithm{.1}, threads, max_nodes};
+    search.run(duration_ms, device, state, model);
+    std::cout << search << " : " << search.get_size() << std::endl;
+}
+
 template <typename... SearchTypes>
 void benchmark_st(std::tuple<SearchTypes...> search_type_tuple)
 {
@@ -73,6 +95,12 @@ int main()
     auto mtp_search_type_tuple = search_type_generator<TreeBanditThreadPool>(bandit_type_pack, node_template_pack);
 
     benchmark_st(st_search_type_tuple);
+    benchmark_flat_<TreeBanditFlat<Exp3<MonteCarloModel<MoldState<>>>>>();
     benchmark_mt(mt_search_type_tuple);
     benchmark_mtp(mtp_search_type_tuple);
+
+    using FlatThreadedTypes = TreeBanditFlatThreaded<Exp3<MonteCarloModel<MoldState<>>>>;
+    benchmark_mt_flat_<FlatThreadedTypes>(1);
+    benchmark_mt_flat_<FlatThreadedTypes>(2);
+    benchmark_mt_flat_<FlatThreadedTypes>(4);
 }
\ No newline at end of file
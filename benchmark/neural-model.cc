@@ -0,0 +1,58 @@
+#include <pinyon.hh>
+
+/*
+
+Evaluations per second of NeuralModel, float and int8, at batch sizes 1 to 256.
+Batch size 1 uses the single state `inference`. The time to gather the features is included.
+
+*/
+
+template <typename Types>
+void benchmark(const std::shared_ptr<const typename Types::Network> &network, const std::string &name)
+{
+    typename Types::Model model{network};
+    const typename Types::State state{prng{0}, 10, 4, 4, 2};
+    const size_t evaluations = 1 << 16;
+    for (size_t batch_size = 1; batch_size <= 256; batch_size *= 2)
+    {
+        typename Types::ModelOutput output;
+        typename Types::ModelBatchInput batch_input{batch_size};
+        typename Types::ModelBatchOutput batch_output;
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < evaluations; i += batch_size)
+        {
+            if (batch_size == 1)
+            {
+                model.inference(typename Types::State{state}, output);
+                continue;
+            }
+            batch_input.clear();
+            for (size_t b = 0; b < batch_size; ++b)
+            {
+                model.add_to_batch_input(typename Types::State{state}, batch_input);
+            }
+            model.inference(batch_input, batch_output);
+        }
+        const auto end = std::chrono::high_resolution_clock::now();
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << name << " batch " << batch_size << ": " << evaluations / seconds << " evals/s" << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    using Types = NeuralModel<HashRandomTree<>>;
+    using QuantizedTypes = NeuralModel<HashRandomTree<>, true>;
+
+    const size_t hidden_1 = argc > 1 ? std::atoi(argv[1]) : 256;
+    const size_t hidden_2 = argc > 2 ? std::atoi(argv[2]) : 64;
+    prng device{0};
+    auto network = std::make_shared<Types::Network>(Types::State::n_features, hidden_1, hidden_2, 4, 4);
+    network->randomize(device);
+
+    std::cout << "avx2: " << NeuralModelDetail::has_avx2() << ", layers: " << Types::State::n_features << " -> "
+              << hidden_1 << " -> " << hidden_2 << " -> 1 + 4 + 4" << std::endl;
+    benchmark<Types>(network, "float");
+    benchmark<QuantizedTypes>(network, "int8");
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <pinyon.hh>
+
+/*
+
+Compare RandomTree against HashRandomTree on the simulator alone (copy and play out to terminal)
+and on a full search, where the state is copied and transitioned every iteration.
+
+*/
+
+const size_t depth = 10;
+const size_t n_actions = 3;
+const size_t transitions = 3;
+const size_t repetitions = 1 << 16;
+
+template <typename Types>
+void benchmark_playout(const typename Types::State &state, const std::string &name)
+{
+    typename Types::PRNG device{0};
+    size_t sink = 0;
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < repetitions; ++i)
+    {
+        typename Types::State state_copy = state;
+        while (!state_copy.is_terminal())
+        {
+            state_copy.randomize_transition(device);
+            state_copy.apply_actions(device.random_int(n_actions), device.random_int(n_actions));
+        }
+        sink += state_copy.get_payoff().get_row_value() > .5;
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(end - start).count() / repetitions;
+    std::cout << name << " playout: " << ns << " ns (" << sink << ")" << std::endl;
+}
+
+template <typename Types>
+void benchmark_search(const typename Types::State &state, const std::string &name)
+{
+    typename Types::PRNG device{0};
+    typename Types::Model model{0};
+    typename Types::MatrixNode root{};
+    typename Types::Search search{};
+    const size_t iterations = 1 << 16;
+    const size_t ms = search.run_for_iterations(iterations, device, state, model, root);
+    std::cout << name << " " << search << " : " << iterations << " iterations in " << ms << " ms" << std::endl;
+}
+
+int main()
+{
+    using Tree = MonteCarloModel<RandomTree<>>;
+    using HashTree = MonteCarloModel<HashRandomTree<>>;
+    const Tree::State tree{prng{0}, depth, n_actions, n_actions, transitions};
+    const HashTree::State hash_tree{prng{0}, depth, n_actions, n_actions, transitions};
+
+    std::cout << "sizeof RandomTree::State: " << sizeof(Tree::State) << std::endl;
+    std::cout << "sizeof HashRandomTree::State: " << sizeof(HashTree::State) << std::endl;
+
+    benchmark_playout<Tree>(tree, "RandomTree");
+    benchmark_playout<HashTree>(hash_tree, "HashRandomTree");
+
+    benchmark_search<TreeBandit<Exp3<Tree>>>(tree, "RandomTree");
+    benchmark_search<TreeBandit<Exp3<HashTree>>>(hash_tree, "HashRandomTree");
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <pinyon.hh>
+
+/*
+
+Compare regret matching+ against Exp3 on random trees.
+
+For each search duration, the exploitability of the root empirical strategies is averaged over the trees,
+along with the iterations per second.
+
+*/
+
+using BaseTypes = MonteCarloModel<RandomTree<>>;
+
+const std::vector<size_t> durations_ms{10, 50, 250};
+const size_t n_trees = 10;
+const size_t depth_bound = 3;
+const size_t actions = 3;
+const size_t transitions = 1;
+
+template <typename Types>
+void benchmark_()
+{
+    for (const size_t duration_ms : durations_ms)
+    {
+        typename Types::Model model{0};
+        double total_expl = 0;
+        size_t total_iterations = 0;
+        for (size_t seed = 0; seed < n_trees; ++seed)
+        {
+            const typename Types::State state{prng{seed}, depth_bound, actions, actions, transitions};
+            auto solved_state = TraversedState<BaseTypes>::State{state, model};
+
+            typename Types::PRNG device{0};
+            typename Types::MatrixNode root{};
+            typename Types::Search search{};
+            total_iterations += search.run(duration_ms, device, state, model, root);
+
+            typename Types::VectorReal row_strategy, col_strategy;
+            typename Types::MatrixValue payoff_matrix;
+            solved_state.get_matrix(payoff_matrix);
+            search.get_empirical_strategies(root.stats, row_strategy, col_strategy);
+            total_expl += math::to_double(math::exploitability(payoff_matrix, row_strategy, col_strategy));
+        }
+        const double seconds = n_trees * duration_ms / 1000.0;
+        std::cout << typename Types::Search{} << " : " << duration_ms << " ms; expl: " << total_expl / n_trees
+                  << "; iterations/sec: " << total_iterations / seconds << std::endl;
+    }
+}
+
+template <typename... SearchTypes>
+void benchmark(std::tuple<SearchTypes...> search_type_tuple)
+{
+    (benchmark_<SearchTypes>(), ...);
+}
+
+int main()
+{
+    auto bandit_type_pack = TypePack<Exp3<BaseTypes>, RMPlus<BaseTypes>, RMPlus<BaseTypes, true>>{};
+    auto node_template_pack = NodeTemplatePack<DefaultNodes>{};
+    auto search_type_tuple = search_type_generator<TreeBandit>(bandit_type_pack, node_template_pack);
+
+    benchmark(search_type_tuple);
+
+    return 0;
+}
@@ -2,6 +2,9 @@
 
 #include <model/model.hh>
 
+#include <algorithm>
+#include <cmath>
+
 template <typename Types>
 concept IsBanditAlgorithmTypes =
     requires(
@@ -119,13 +122,36 @@ concept IsTreeBanditTypes =
     } &&
     IsBanditAlgorithmTypes<Types>;
 
+/*
+
+Number of active actions at a node with `visits` visits is ceil(c * (visits + 1) ^ alpha), clamped to [1, actions]
+
+*/
+
+template <
+    size_t c_num = 1,
+    size_t c_den = 1,
+    size_t alpha_num = 1,
+    size_t alpha_den = 2>
+struct ProgressiveWidening
+{
+    static size_t get_active_actions(const size_t visits, const size_t actions)
+    {
+        constexpr double c = static_cast<double>(c_num) / c_den;
+        constexpr double alpha = static_cast<double>(alpha_num) / alpha_den;
+        const size_t active = static_cast<size_t>(std::ceil(c * std::pow(static_cast<double>(visits + 1), alpha)));
+        return std::clamp(active, size_t{1}, actions);
+    }
+};
+
 template <
     typename rae = void, 
     typename uua = void, 
     typename node_actions = void, 
     typename node_value = void,
     size_t max_iter = 1 << 10,
-    size_t max_d = 1 << 4>
+    size_t max_d = 1 << 4,
+    typename widening = void>
 struct SearchOptions
 {
     // if false, iterations always rollout until terminal
@@ -139,6 +165,10 @@ struct SearchOptions
 
     static const size_t max_iterations = max_iter;
     static const size_t max_depth = max_d;
+    // e.g. ProgressiveWidening<>. void means all actions are active on expansion.
+    // only TreeBandit supports this; the other searches fail a static_assert. The bandit's `expand` must keep its stats
+    // by (row, col) when called again with more actions
+    using Widening = widening;
 };
 
 template <typename Types>
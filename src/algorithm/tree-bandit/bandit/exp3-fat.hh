@@ -38,7 +38,7 @@ struct Exp3Fat : Types
         int visits = 0;
         PairReal<Real> value_total{0, 0};
 
-        DataMatrix<Data> matrix;
+        typename DataMatrixOf<Types, Data>::type matrix;
     };
     struct ChanceStats
     {
@@ -130,7 +130,8 @@ struct Exp3Fat : Types
             stats.col_visits.resize(cols, 0);
             stats.row_gains.resize(rows, 0);
             stats.col_gains.resize(cols, 0);
-            stats.matrix.fill(rows, cols);
+            // entries keep their (row, col) if this is called again with more actions, e.g. progressive widening
+            resize_entries(stats.matrix, rows, cols);
         }
 
         void select(
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm/algorithm.hh>
+#include <libpinyon/lrslib.hh>
+#include <libpinyon/math.hh>
+#include <tree/tree.hh>
+#include <types/matrix.hh>
+
+/*
+MatrixUCB with the same selection rule, but cheaper bookkeeping.
+
+The UCB entry mean(i, j) + c * sqrt(log N / n(i, j)) is factored as mean(i, j) + (c * sqrt(log N)) * (1 / sqrt(n(i, j))).
+The second factor is cached per entry and only changes when that entry is updated,
+so building the UCB matrix needs one log and one sqrt in total rather than one of each per entry.
+The matrix is the same as MatrixUCB's, and with `check_interval` 1 and `solver_iterations` 0 so is the search.
+Like MatrixUCB, nothing is solved before the first visit, when log N is undefined.
+
+The matrix is only built and checked every `check_interval` visits. In between, the stored strategies are sampled.
+If they are too exploitable, `solver_iterations` of regret matching+ are run starting from the stored strategies,
+since the UCB matrix changes little between checks. LRS is only called if that does not get below `expl_threshold`.
+*/
+
+template <IsValueModelTypes Types>
+struct MatrixUCBIncremental : Types {
+    using Real = typename Types::Real;
+    using MatrixPairReal = typename Types::template Matrix<PairReal<Real>>;
+
+    struct MatrixStats {
+        struct Data {
+            Types::Value value;
+            int visits = 0;
+            // 1 / sqrt(max(visits, 1))
+            Real inv_sqrt_n{1};
+        };
+        int total_visits{};
+        int next_check{};
+        typename DataMatrixOf<Types, Data>::type data_matrix;
+        Types::VectorReal row_strategy;
+        Types::VectorReal col_strategy;
+    };
+
+    struct ChanceStats {};
+
+    struct Outcome {
+        int row_idx, col_idx;
+        Types::Value value;
+    };
+
+    class BanditAlgorithm {
+       public:
+        const Real c_uct{2};
+        const Real expl_threshold{.005};
+        const int check_interval{8};
+        const int solver_iterations{32};
+
+        BanditAlgorithm() {}
+
+        BanditAlgorithm(Real c_uct) : c_uct(c_uct) {}
+
+        BanditAlgorithm(Real c_uct, Real expl_threshold) : c_uct(c_uct), expl_threshold(expl_threshold) {}
+
+        BanditAlgorithm(Real c_uct, Real expl_threshold, int check_interval, int solver_iterations)
+            : c_uct(c_uct),
+              expl_threshold(expl_threshold),
+              check_interval(check_interval),
+              solver_iterations(solver_iterations) {}
+
+        friend std::ostream &operator<<(std::ostream &os, const BanditAlgorithm &session) {
+            os << "MatrixUCBIncremental; c_uct: " << session.c_uct << ", expl_threshold: " << session.expl_threshold
+               << ", check_interval: " << session.check_interval
+               << ", solver_iterations: " << session.solver_iterations;
+            return os;
+        }
+
+        void get_empirical_strategies(const MatrixStats &stats, Types::VectorReal &row_strategy,
+                                      Types::VectorReal &col_strategy) const {
+            const int rows = stats.data_matrix.rows;
+            const int cols = stats.data_matrix.cols;
+            row_strategy.clear();
+            col_strategy.clear();
+            row_strategy.resize(rows);
+            col_strategy.resize(cols);
+            for (int row_idx = 0; row_idx < rows; ++row_idx) {
+                for (int col_idx = 0; col_idx < cols; ++col_idx) {
+                    const int n = stats.data_matrix.get(row_idx, col_idx).visits;
+                    row_strategy[row_idx] += n;
+                    col_strategy[col_idx] += n;
+                }
+            }
+            math::power_norm(row_strategy, rows, 1, row_strategy);
+            math::power_norm(col_strategy, cols, 1, col_strategy);
+        }
+
+        void get_empirical_value(const MatrixStats &stats, Types::Value &value) const {
+            PairReal<Real> value_total{0, 0};
+            for (const auto &data : stats.data_matrix) {
+                value_total += PairReal<Real>{data.value.get_row_value(), data.value.get_col_value()};
+            }
+            const Real den = typename Types::Q{1, (stats.total_visits + (stats.total_visits == 0))};
+            if constexpr (Types::Value::IS_CONSTANT_SUM) {
+                value = typename Types::Value{Real{value_total.get_row_value() * den}};
+            } else {
+                value = typename Types::Value{value_total * den};
+            }
+        }
+
+        // the strategies last used for selection
+        void get_refined_strategies(const MatrixStats &stats, Types::VectorReal &row_strategy,
+                                    Types::VectorReal &col_strategy) const {
+            row_strategy = stats.row_strategy;
+            col_strategy = stats.col_strategy;
+        }
+
+        void get_refined_value(const MatrixStats &stats, Types::Value &value) const {
+            get_empirical_value(stats, value);
+        }
+
+        void initialize_stats(int iterations, const Types::State &state, Types::Model &model,
+                              MatrixStats &stats) const {}
+
+        // may be called again with more actions, e.g. progressive widening. Entries keep their (row, col),
+        // new actions start with no probability, and the next select checks the strategies
+        void expand(MatrixStats &stats, const size_t &rows, const size_t &cols,
+                    const Types::ModelOutput &output) const {
+            const bool widened = !stats.row_strategy.empty();
+            resize_entries(stats.data_matrix, rows, cols);
+            if (widened) {
+                stats.row_strategy.resize(rows, Real{0});
+                stats.col_strategy.resize(cols, Real{0});
+                stats.next_check = stats.total_visits;
+            } else {
+                stats.row_strategy.resize(rows, 1 / static_cast<Real>(rows));
+                stats.col_strategy.resize(cols, 1 / static_cast<Real>(cols));
+            }
+        }
+
+        void select(Types::PRNG &device, MatrixStats &stats, Outcome &outcome) const {
+            if (stats.total_visits > 0 && stats.total_visits >= stats.next_check) {
+                stats.next_check = stats.total_visits + check_interval;
+                MatrixPairReal ucb_matrix{stats.data_matrix.rows, stats.data_matrix.cols};
+                get_ucb_matrix(stats, ucb_matrix);
+                if (math::exploitability(ucb_matrix, stats.row_strategy, stats.col_strategy) > expl_threshold) {
+                    solve(ucb_matrix, stats.row_strategy, stats.col_strategy);
+                }
+            }
+            outcome.row_idx = device.sample_pdf(stats.row_strategy);
+            outcome.col_idx = device.sample_pdf(stats.col_strategy);
+        }
+
+        void update_matrix_stats(MatrixStats &stats, const Outcome &outcome) const {
+            ++stats.total_visits;
+            auto &data = stats.data_matrix.get(outcome.row_idx, outcome.col_idx);
+            data.value += outcome.value;
+            ++data.visits;
+            data.inv_sqrt_n = Real{1 / std::sqrt(static_cast<double>(data.visits))};
+        }
+
+        void update_chance_stats(ChanceStats &stats, const Outcome &outcome) const {}
+
+        // multithreaded
+
+        void select(Types::PRNG &device, MatrixStats &stats, Outcome &outcome, Types::Mutex &mutex) const {
+            mutex.lock();
+            select(device, stats, outcome);
+            mutex.unlock();
+        }
+
+        void update_matrix_stats(MatrixStats &stats, const Outcome &outcome, Types::Mutex &mutex) const {
+            mutex.lock();
+            update_matrix_stats(stats, outcome);
+            mutex.unlock();
+        }
+
+        void update_chance_stats(ChanceStats &stats, const Outcome &outcome, Types::Mutex &mutex) const {}
+
+        // private:
+        void get_ucb_matrix(const MatrixStats &stats, MatrixPairReal &ucb_matrix) const {
+            const size_t entries = stats.data_matrix.size();
+            const Real eta{this->c_uct * std::sqrt(std::log(static_cast<double>(stats.total_visits)))};
+            for (size_t entry_idx = 0; entry_idx < entries; ++entry_idx) {
+                const auto &data = stats.data_matrix[entry_idx];
+                const int n = data.visits + (data.visits == 0);
+                const Real bonus{eta * data.inv_sqrt_n};
+                auto &ucb_pair = ucb_matrix[entry_idx];
+                ucb_pair.row_value = data.value.get_row_value() / n + bonus;
+                ucb_pair.col_value = data.value.get_col_value() / n + bonus;
+            }
+        }
+
+        // regret matching+ warm started from the given strategies, falling back to LRS
+        void solve(const MatrixPairReal &ucb_matrix, Types::VectorReal &row_strategy,
+                   Types::VectorReal &col_strategy) const {
+            const size_t rows = ucb_matrix.rows;
+            const size_t cols = ucb_matrix.cols;
+            const Real zero{Rational<>{0}};
+            typename Types::VectorReal row_regret(rows, zero), col_regret(cols, zero);
+            typename Types::VectorReal row_utility(rows), col_utility(cols);
+            typename Types::VectorReal row_current{row_strategy}, col_current{col_strategy};
+            // the previous strategies count as the first iteration of the average
+            typename Types::VectorReal row_average{row_strategy}, col_average{col_strategy};
+
+            for (int t = 2; t < solver_iterations + 2; ++t) {
+                std::fill(row_utility.begin(), row_utility.end(), zero);
+                std::fill(col_utility.begin(), col_utility.end(), zero);
+                size_t entry_idx = 0;
+                for (size_t row_idx = 0; row_idx < rows; ++row_idx) {
+                    for (size_t col_idx = 0; col_idx < cols; ++col_idx) {
+                        const auto &ucb_pair = ucb_matrix[entry_idx++];
+                        row_utility[row_idx] += col_current[col_idx] * ucb_pair.row_value;
+                        col_utility[col_idx] += row_current[row_idx] * ucb_pair.col_value;
+                    }
+                }
+                regret_matching(row_utility, row_regret, row_current);
+                regret_matching(col_utility, col_regret, col_current);
+                for (size_t row_idx = 0; row_idx < rows; ++row_idx) {
+                    row_average[row_idx] += row_current[row_idx] * t;
+                }
+                for (size_t col_idx = 0; col_idx < cols; ++col_idx) {
+                    col_average[col_idx] += col_current[col_idx] * t;
+                }
+            }
+            math::power_norm(row_average, rows, 1, row_strategy);
+            math::power_norm(col_average, cols, 1, col_strategy);
+
+            if (math::exploitability(ucb_matrix, row_strategy, col_strategy) > expl_threshold) {
+                LRSNash::solve(ucb_matrix, row_strategy, col_strategy);
+            }
+        }
+
+       private:
+        // updates the clipped regrets given the utilities of the current strategy, then the current strategy
+        static void regret_matching(const Types::VectorReal &utility, Types::VectorReal &regret,
+                                    Types::VectorReal &current) {
+            const size_t k = utility.size();
+            const Real zero{Rational<>{0}};
+            Real ev{zero};
+            for (size_t i = 0; i < k; ++i) {
+                ev += current[i] * utility[i];
+            }
+            Real sum{zero};
+            for (size_t i = 0; i < k; ++i) {
+                regret[i] = std::max(Real{regret[i] + utility[i] - ev}, zero);
+                sum += regret[i];
+            }
+            if (sum > zero) {
+                for (size_t i = 0; i < k; ++i) {
+                    current[i] = regret[i] / sum;
+                }
+            }
+        }
+    };
+};
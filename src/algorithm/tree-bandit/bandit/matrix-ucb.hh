@@ -25,7 +25,7 @@ struct MatrixUCB : Types {
             int visits;
         };
         int total_visits{};
-        DataMatrix<Data> data_matrix;
+        typename DataMatrixOf<Types, Data>::type data_matrix;
         Types::VectorReal row_strategy;
         Types::VectorReal col_strategy;
     };
@@ -80,17 +80,37 @@ struct MatrixUCB : Types {
             LRSNash::solve(value_matrix, row_strategy, col_strategy);
         }
 
-        void get_empirical_value(const MatrixStats &stats, Types::Value value) const
-        {
-            // TODO - added temp flag to search model to ignore this
-        };
+        void get_empirical_value(const MatrixStats &stats, Types::Value &value) const {
+            PairReal<Real> value_total{0, 0};
+            for (const auto &data : stats.data_matrix) {
+                value_total += PairReal<Real>{data.value.get_row_value(), data.value.get_col_value()};
+            }
+            const Real den = typename Types::Q{1, (stats.total_visits + (stats.total_visits == 0))};
+            if constexpr (Types::Value::IS_CONSTANT_SUM) {
+                value = typename Types::Value{Real{value_total.get_row_value() * den}};
+            } else {
+                value = typename Types::Value{value_total * den};
+            }
+        }
 
+        void get_refined_value(const MatrixStats &stats, Types::Value &value) const {
+            get_empirical_value(stats, value);
+        }
+
+        // may be called again with more actions, e.g. progressive widening. Entries keep their (row, col),
+        // and new actions start with no probability until the strategies are next solved
         void expand(MatrixStats &stats, const size_t &rows, const size_t &cols,
-                    const Types::ModelOutput &output) const {  // matrix_node->is_expanded = true;
-            stats.data_matrix.fill(rows, cols, {});
-            // uniform initialization of stats.strategies
-            stats.row_strategy.resize(rows, 1 / static_cast<Real>(rows));
-            stats.col_strategy.resize(cols, 1 / static_cast<Real>(cols));
+                    const Types::ModelOutput &output) const {
+            const bool widened = !stats.row_strategy.empty();
+            resize_entries(stats.data_matrix, rows, cols);
+            if (widened) {
+                stats.row_strategy.resize(rows, Real{0});
+                stats.col_strategy.resize(cols, Real{0});
+            } else {
+                // uniform initialization of stats.strategies
+                stats.row_strategy.resize(rows, 1 / static_cast<Real>(rows));
+                stats.col_strategy.resize(cols, 1 / static_cast<Real>(cols));
+            }
         }
 
         void select(Types::PRNG &device, MatrixStats &stats, Outcome &outcome) const {
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm/algorithm.hh>
+#include <libpinyon/math.hh>
+#include <tree/tree.hh>
+
+#include <algorithm>
+#include <cmath>
+
+/*
+Decoupled PUCT. Each player selects argmax over Q(a) + c * P(a) * sqrt(N) / (1 + N(a)), as in AlphaZero.
+
+The priors are taken from the model's policy at expansion, or uniform if the model has no policy
+or its policy has fewer entries than there are actions.
+All per-action data is stored as float arrays so that the score loop has no branches and can be vectorised.
+Unvisited actions use the node's mean value as their Q (first play urgency).
+*/
+
+template <IsValueModelTypes Types>
+struct PUCT : Types {
+    using Real = typename Types::Real;
+    using VectorFloat = typename Types::template Vector<float>;
+
+    struct MatrixStats {
+        VectorFloat row_priors;
+        VectorFloat col_priors;
+        VectorFloat row_value_total;
+        VectorFloat col_value_total;
+        VectorFloat row_visits;
+        VectorFloat col_visits;
+
+        int visits = 0;
+        PairReal<Real> value_total{0, 0};
+    };
+    struct ChanceStats {};
+    struct Outcome {
+        int row_idx, col_idx;
+        Types::Value value;
+    };
+
+    class BanditAlgorithm {
+       public:
+        const float c{2};
+
+        constexpr BanditAlgorithm() {}
+
+        constexpr BanditAlgorithm(float c) : c{c} {}
+
+        friend std::ostream &operator<<(std::ostream &os, const BanditAlgorithm &search) {
+            os << "PUCT; c: " << search.c;
+            return os;
+        }
+
+        void get_empirical_strategies(const MatrixStats &stats, Types::VectorReal &row_strategy,
+                                      Types::VectorReal &col_strategy) const {
+            row_strategy.resize(stats.row_visits.size());
+            col_strategy.resize(stats.col_visits.size());
+            math::power_norm(stats.row_visits, row_strategy.size(), 1, row_strategy);
+            math::power_norm(stats.col_visits, col_strategy.size(), 1, col_strategy);
+        }
+
+        void get_empirical_value(const MatrixStats &stats, Types::Value &value) const {
+            const Real den = typename Types::Q{1, (stats.visits + (stats.visits == 0))};
+            if constexpr (Types::Value::IS_CONSTANT_SUM) {
+                value = typename Types::Value{Real{stats.value_total.get_row_value() * den}};
+            } else {
+                value = typename Types::Value{stats.value_total * den};
+            }
+        }
+
+        void get_refined_strategies(const MatrixStats &stats, Types::VectorReal &row_strategy,
+                                    Types::VectorReal &col_strategy) const {
+            get_empirical_strategies(stats, row_strategy, col_strategy);
+        }
+
+        void get_refined_value(const MatrixStats &stats, Types::Value &value) const {
+            get_empirical_value(stats, value);
+        }
+
+        // protected:
+        void initialize_stats(int iterations, const Types::State &state, Types::Model &model,
+                              MatrixStats &stats) const {}
+
+        // may be called again with more actions, e.g. progressive widening. Existing data is kept
+        void expand(MatrixStats &stats, const size_t &rows, const size_t &cols,
+                    const Types::ModelOutput &output) const {
+            stats.row_value_total.resize(rows, 0);
+            stats.col_value_total.resize(cols, 0);
+            stats.row_visits.resize(rows, 0);
+            stats.col_visits.resize(cols, 0);
+            if constexpr (IsPolicyModelTypes<Types>) {
+                // the policy may cover more actions than are active
+                copy_priors(output.row_policy, rows, stats.row_priors);
+                copy_priors(output.col_policy, cols, stats.col_priors);
+            } else {
+                stats.row_priors.resize(rows);
+                stats.col_priors.resize(cols);
+                std::fill(stats.row_priors.begin(), stats.row_priors.end(), 1.0f / rows);
+                std::fill(stats.col_priors.begin(), stats.col_priors.end(), 1.0f / cols);
+            }
+        }
+
+        void select(Types::PRNG &device, const MatrixStats &stats, Outcome &outcome) const {
+            // at least 1, so that the priors decide the first selection
+            const float sqrt_n = std::sqrt(static_cast<float>(std::max(stats.visits, 1)));
+            const float visits = stats.visits + (stats.visits == 0);
+            const float row_fpu = math::to_double(stats.value_total.get_row_value()) / visits;
+            const float col_fpu = math::to_double(stats.value_total.get_col_value()) / visits;
+            outcome.row_idx = argmax_score(stats.row_priors, stats.row_value_total, stats.row_visits, sqrt_n, row_fpu);
+            outcome.col_idx = argmax_score(stats.col_priors, stats.col_value_total, stats.col_visits, sqrt_n, col_fpu);
+        }
+
+        void update_matrix_stats(MatrixStats &stats, const Outcome &outcome) const {
+            stats.value_total += PairReal<Real>{outcome.value.get_row_value(), outcome.value.get_col_value()};
+            stats.visits += 1;
+            stats.row_value_total[outcome.row_idx] += math::to_double(outcome.value.get_row_value());
+            stats.col_value_total[outcome.col_idx] += math::to_double(outcome.value.get_col_value());
+            stats.row_visits[outcome.row_idx] += 1;
+            stats.col_visits[outcome.col_idx] += 1;
+        }
+
+        void update_chance_stats(ChanceStats &stats, const Outcome &outcome) const {}
+
+        // multithreaded
+
+        void select(Types::PRNG &device, const MatrixStats &stats, Outcome &outcome, Types::Mutex &mutex) const {
+            mutex.lock();
+            select(device, stats, outcome);
+            mutex.unlock();
+        }
+
+        void update_matrix_stats(MatrixStats &stats, const Outcome &outcome, Types::Mutex &mutex) const {
+            mutex.lock();
+            update_matrix_stats(stats, outcome);
+            mutex.unlock();
+        }
+
+        void update_chance_stats(ChanceStats &stats, const Outcome &outcome, Types::Mutex &mutex) const {}
+
+       private:
+        // a policy that does not cover every action is ignored
+        static void copy_priors(const Types::VectorReal &policy, const size_t k, VectorFloat &priors) {
+            priors.resize(k);
+            if (policy.size() < k) {
+                std::fill(priors.begin(), priors.end(), 1.0f / k);
+                return;
+            }
+            for (size_t i = 0; i < k; ++i) {
+                priors[i] = math::to_double(policy[i]);
+            }
+        }
+
+        inline int argmax_score(const VectorFloat &priors, const VectorFloat &value_total, const VectorFloat &visits,
+                                const float sqrt_n, const float fpu) const {
+            const size_t k = priors.size();
+            float scores[k];
+            for (size_t i = 0; i < k; ++i) {
+                const float unvisited = visits[i] == 0;
+                const float q = (value_total[i] + unvisited * fpu) / (visits[i] + unvisited);
+                scores[i] = q + c * priors[i] * sqrt_n / (1 + visits[i]);
+            }
+            return std::max_element(scores, scores + k) - scores;
+        }
+    };
+};
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm/algorithm.hh>
+#include <libpinyon/math.hh>
+#include <tree/tree.hh>
+
+/*
+Decoupled regret matching+ with outcome sampling.
+
+Each player plays proportionally to its positive regrets, mixed with `gamma` uniform exploration.
+Only the sampled action's utility is observed, so it is importance weighted by the probability it was played with.
+Then every regret is updated and clipped at 0. There is no exponential, and one division per player per update.
+
+If `average` is true, the linearly weighted average of the played strategies is kept and used as the empirical strategy.
+Otherwise the visit counts are used, like Exp3.
+*/
+
+template <IsValueModelTypes Types, bool average = false>
+struct RMPlus : Types {
+    using Real = typename Types::Real;
+    using VectorFloat = typename Types::template Vector<float>;
+
+    struct MatrixStats {
+        VectorFloat row_regrets;
+        VectorFloat col_regrets;
+        Types::VectorInt row_visits;
+        Types::VectorInt col_visits;
+        // only used when averaging
+        VectorFloat row_strategy_sum;
+        VectorFloat col_strategy_sum;
+
+        int visits = 0;
+        PairReal<Real> value_total{0, 0};
+    };
+    struct ChanceStats {};
+    struct Outcome {
+        int row_idx, col_idx;
+        Types::Value value;
+        float row_mu, col_mu;
+    };
+
+    class BanditAlgorithm {
+       public:
+        const float gamma{.01};
+
+        constexpr BanditAlgorithm() {}
+
+        constexpr BanditAlgorithm(float gamma) : gamma{gamma} {}
+
+        friend std::ostream &operator<<(std::ostream &os, const BanditAlgorithm &search) {
+            os << "RMPlus; gamma: " << search.gamma << "; average: " << average;
+            return os;
+        }
+
+        void get_empirical_strategies(const MatrixStats &stats, Types::VectorReal &row_strategy,
+                                      Types::VectorReal &col_strategy) const {
+            row_strategy.resize(stats.row_visits.size());
+            col_strategy.resize(stats.col_visits.size());
+            if constexpr (average) {
+                math::power_norm(stats.row_strategy_sum, row_strategy.size(), 1, row_strategy);
+                math::power_norm(stats.col_strategy_sum, col_strategy.size(), 1, col_strategy);
+            } else {
+                math::power_norm(stats.row_visits, row_strategy.size(), 1, row_strategy);
+                math::power_norm(stats.col_visits, col_strategy.size(), 1, col_strategy);
+            }
+        }
+
+        void get_empirical_value(const MatrixStats &stats, Types::Value &value) const {
+            const Real den = typename Types::Q{1, (stats.visits + (stats.visits == 0))};
+            if constexpr (Types::Value::IS_CONSTANT_SUM) {
+                value = typename Types::Value{Real{stats.value_total.get_row_value() * den}};
+            } else {
+                value = typename Types::Value{stats.value_total * den};
+            }
+        }
+
+        // the current regret matching strategies, without exploration
+        void get_refined_strategies(const MatrixStats &stats, Types::VectorReal &row_strategy,
+                                    Types::VectorReal &col_strategy) const {
+            const size_t rows = stats.row_regrets.size();
+            const size_t cols = stats.col_regrets.size();
+            float row_forecast[rows];
+            float col_forecast[cols];
+            regret_matching(stats.row_regrets.data(), rows, 0, row_forecast);
+            regret_matching(stats.col_regrets.data(), cols, 0, col_forecast);
+            row_strategy.resize(rows);
+            col_strategy.resize(cols);
+            for (size_t i = 0; i < rows; ++i) {
+                row_strategy[i] = Real{row_forecast[i]};
+            }
+            for (size_t j = 0; j < cols; ++j) {
+                col_strategy[j] = Real{col_forecast[j]};
+            }
+        }
+
+        void get_refined_value(const MatrixStats &stats, Types::Value &value) const {
+            get_empirical_value(stats, value);
+        }
+
+        // protected:
+        void initialize_stats(int, const Types::State &, Types::Model &, MatrixStats &) const {}
+
+        void expand(MatrixStats &stats, const size_t &rows, const size_t &cols,
+                    const Types::ModelOutput &) const {
+            stats.row_regrets.resize(rows, 0);
+            stats.col_regrets.resize(cols, 0);
+            stats.row_visits.resize(rows, 0);
+            stats.col_visits.resize(cols, 0);
+            if constexpr (average) {
+                stats.row_strategy_sum.resize(rows, 0);
+                stats.col_strategy_sum.resize(cols, 0);
+            }
+        }
+
+        void select(Types::PRNG &device, const MatrixStats &stats, Outcome &outcome) const {
+            const size_t rows = stats.row_regrets.size();
+            const size_t cols = stats.col_regrets.size();
+            float row_forecast[rows];
+            float col_forecast[cols];
+            regret_matching(stats.row_regrets.data(), rows, gamma, row_forecast);
+            regret_matching(stats.col_regrets.data(), cols, gamma, col_forecast);
+            outcome.row_idx = sample(device, row_forecast, rows);
+            outcome.col_idx = sample(device, col_forecast, cols);
+            outcome.row_mu = row_forecast[outcome.row_idx];
+            outcome.col_mu = col_forecast[outcome.col_idx];
+        }
+
+        void update_matrix_stats(MatrixStats &stats, const Outcome &outcome) const {
+            stats.value_total += PairReal<Real>{outcome.value.get_row_value(), outcome.value.get_col_value()};
+            stats.visits += 1;
+            stats.row_visits[outcome.row_idx] += 1;
+            stats.col_visits[outcome.col_idx] += 1;
+            const float row_value = math::to_double(outcome.value.get_row_value());
+            const float col_value = math::to_double(outcome.value.get_col_value());
+            if constexpr (average) {
+                accumulate_strategy(stats.row_regrets.data(), stats.row_regrets.size(), stats.visits,
+                                    stats.row_strategy_sum.data());
+                accumulate_strategy(stats.col_regrets.data(), stats.col_regrets.size(), stats.visits,
+                                    stats.col_strategy_sum.data());
+            }
+            update_regrets(stats.row_regrets.data(), stats.row_regrets.size(), outcome.row_idx, row_value,
+                           outcome.row_mu);
+            update_regrets(stats.col_regrets.data(), stats.col_regrets.size(), outcome.col_idx, col_value,
+                           outcome.col_mu);
+        }
+
+        void update_chance_stats(ChanceStats &, const Outcome &) const {}
+
+        // multithreaded
+
+        void select(Types::PRNG &device, const MatrixStats &stats, Outcome &outcome, Types::Mutex &mutex) const {
+            mutex.lock();
+            const size_t rows = stats.row_regrets.size();
+            const size_t cols = stats.col_regrets.size();
+            float row_forecast[rows];
+            float col_forecast[cols];
+            regret_matching(stats.row_regrets.data(), rows, gamma, row_forecast);
+            regret_matching(stats.col_regrets.data(), cols, gamma, col_forecast);
+            mutex.unlock();
+            outcome.row_idx = sample(device, row_forecast, rows);
+            outcome.col_idx = sample(device, col_forecast, cols);
+            outcome.row_mu = row_forecast[outcome.row_idx];
+            outcome.col_mu = col_forecast[outcome.col_idx];
+        }
+
+        void update_matrix_stats(MatrixStats &stats, const Outcome &outcome, Types::Mutex &mutex) const {
+            mutex.lock();
+            update_matrix_stats(stats, outcome);
+            mutex.unlock();
+        }
+
+        void update_chance_stats(ChanceStats &, const Outcome &, Types::Mutex &) const {}
+
+       private:
+        static inline void regret_matching(const float *regrets, const size_t k, const float gamma, float *forecast) {
+            float sum = 0;
+            for (size_t i = 0; i < k; ++i) {
+                sum += regrets[i];
+            }
+            // regrets are clipped at 0 on update, so a zero sum means all regrets are zero
+            const float uniform = 1.0f / k;
+            if (sum > 0) {
+                const float scale = (1 - gamma) / sum;
+                const float eta = gamma * uniform;
+                for (size_t i = 0; i < k; ++i) {
+                    forecast[i] = regrets[i] * scale + eta;
+                }
+            } else {
+                std::fill_n(forecast, k, uniform);
+            }
+        }
+
+        template <typename PRNG>
+        static inline int sample(PRNG &device, const float *forecast, const size_t k) {
+            double p = device.uniform();
+            for (size_t i = 0; i < k; ++i) {
+                p -= forecast[i];
+                if (p <= 0) {
+                    return i;
+                }
+            }
+            return k - 1;
+        }
+
+        static inline void update_regrets(float *regrets, const size_t k, const int idx, const float value,
+                                          const float mu) {
+            // importance weighted utility of the sampled action, minus the value of the played strategy
+            regrets[idx] += value / mu;
+            for (size_t i = 0; i < k; ++i) {
+                regrets[i] = std::max(regrets[i] - value, 0.0f);
+            }
+        }
+
+        static inline void accumulate_strategy(const float *regrets, const size_t k, const int weight,
+                                               float *strategy_sum) {
+            float forecast[k];
+            regret_matching(regrets, k, 0, forecast);
+            for (size_t i = 0; i < k; ++i) {
+                strategy_sum[i] += weight * forecast[i];
+            }
+        }
+    };
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm/algorithm.hh>
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+/*
+
+Non-blocking wrapper for the tree bandit searches (TreeBandit, TreeBanditThreaded, TreeBanditThreadPool)
+
+The wrapped search is run on a background thread in chunks of `chunk_iterations` using `run_for_iterations`.
+All of the wrapped searches join their worker threads before `run_for_iterations` returns,
+so the tree is quiescent between chunks. That is when the root strategies and value are copied into a snapshot,
+which `poll` can read at any time without touching the tree.
+
+The latency of `stop`, `extend`, etc is therefore at most the duration of one chunk.
+
+*/
+
+template <IsSearchTypes Types>
+struct AsyncSearch : Types
+{
+    using Clock = std::chrono::steady_clock;
+
+    class Handle
+    {
+    public:
+        Handle(
+            const Types::Search &search,
+            const size_t chunk_iterations,
+            const Clock::time_point deadline,
+            const Types::PRNG &device,
+            const Types::State &state,
+            const Types::Model &model,
+            Types::MatrixNode &matrix_node)
+            : search{search},
+              chunk_iterations{chunk_iterations},
+              device{device},
+              state{state},
+              model{model},
+              matrix_node{&matrix_node},
+              deadline{deadline.time_since_epoch().count()}
+        {
+            thread = std::thread(&Handle::run_thread, this);
+        }
+
+        Handle(const Handle &) = delete;
+        Handle &operator=(const Handle &) = delete;
+
+        ~Handle()
+        {
+            stop();
+        }
+
+        // copies the root stats as of the last completed chunk, returns the iterations at that time
+        size_t poll(
+            Types::VectorReal &row_strategy,
+            Types::VectorReal &col_strategy,
+            Types::Value &value) const
+        {
+            std::lock_guard<std::mutex> lock{snapshot_mutex};
+            row_strategy = snapshot_row_strategy;
+            col_strategy = snapshot_col_strategy;
+            value = snapshot_value;
+            return snapshot_iterations;
+        }
+
+        size_t get_iterations() const
+        {
+            return iterations.load(std::memory_order_relaxed);
+        }
+
+        bool is_running() const
+        {
+            return !finished.load(std::memory_order_acquire);
+        }
+
+        bool is_pondering() const
+        {
+            return deadline.load(std::memory_order_relaxed) == max_deadline;
+        }
+
+        // push the deadline back. Has no effect if the search has already finished or is pondering
+        void extend(const size_t duration_ms)
+        {
+            const auto extension = std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds{duration_ms}).count();
+            auto current = deadline.load(std::memory_order_relaxed);
+            while (current != max_deadline &&
+                   !deadline.compare_exchange_weak(current, current + extension, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        // the opponent played the move we were pondering on; keep the tree and search for `duration_ms` more
+        void ponder_hit(const size_t duration_ms)
+        {
+            deadline.store((Clock::now() + std::chrono::milliseconds{duration_ms}).time_since_epoch().count(), std::memory_order_relaxed);
+        }
+
+        // request the search stop after the current chunk and wait for it, returns total iterations
+        size_t stop()
+        {
+            stop_flag.store(true, std::memory_order_relaxed);
+            return wait();
+        }
+
+        // block until the deadline is reached. Blocks forever if pondering and no other thread calls `stop`
+        size_t wait()
+        {
+            if (thread.joinable())
+            {
+                thread.join();
+            }
+            return iterations.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr Clock::rep max_deadline = std::numeric_limits<Clock::rep>::max();
+
+        // copy since TreeBanditThreadPool::run_for_iterations is not const
+        typename Types::Search search;
+        const size_t chunk_iterations;
+        typename Types::PRNG device;
+        const typename Types::State state;
+        typename Types::Model model;
+        typename Types::MatrixNode *const matrix_node;
+
+        std::atomic<Clock::rep> deadline;
+        std::atomic<bool> stop_flag{false};
+        std::atomic<bool> finished{false};
+        std::atomic<size_t> iterations{0};
+
+        mutable std::mutex snapshot_mutex{};
+        typename Types::VectorReal snapshot_row_strategy{};
+        typename Types::VectorReal snapshot_col_strategy{};
+        typename Types::Value snapshot_value{};
+        size_t snapshot_iterations = 0;
+
+        std::thread thread{};
+
+        void run_thread()
+        {
+            typename Types::VectorReal row_strategy, col_strategy;
+            typename Types::Value value;
+            while (!stop_flag.load(std::memory_order_relaxed) &&
+                   Clock::now().time_since_epoch().count() < deadline.load(std::memory_order_relaxed))
+            {
+                search.run_for_iterations(chunk_iterations, device, state, model, *matrix_node);
+                const size_t total = iterations.fetch_add(chunk_iterations, std::memory_order_relaxed) + chunk_iterations;
+
+                // the tree is not being modified at this point
+                search.get_empirical_strategies(matrix_node->stats, row_strategy, col_strategy);
+                search.get_empirical_value(matrix_node->stats, value);
+                {
+                    std::lock_guard<std::mutex> lock{snapshot_mutex};
+                    std::swap(snapshot_row_strategy, row_strategy);
+                    std::swap(snapshot_col_strategy, col_strategy);
+                    snapshot_value = value;
+                    snapshot_iterations = total;
+                }
+            }
+            finished.store(true, std::memory_order_release);
+        }
+    };
+
+    class Search : public Types::Search
+    {
+    public:
+        using Types::Search::Search;
+
+        Search(const Types::Search &base) : Types::Search{base} {}
+
+        Search(const Types::Search &base, const size_t chunk_iterations)
+            : Types::Search{base}, chunk_iterations{chunk_iterations} {}
+
+        // the multithreaded searches divide a chunk among their threads, so it should be a multiple of the thread count
+        size_t chunk_iterations = 1 << 8;
+
+        friend std::ostream &operator<<(std::ostream &os, const Search &search)
+        {
+            os << "AsyncSearch; chunk iterations: " << search.chunk_iterations << " - ";
+            os << static_cast<const typename Types::Search &>(search);
+            return os;
+        }
+
+        // the handle must not outlive the matrix node
+        Handle start(
+            const size_t duration_ms,
+            Types::PRNG &device,
+            const Types::State &state,
+            const Types::Model &model,
+            Types::MatrixNode &matrix_node) const
+        {
+            return Handle{
+                *this, chunk_iterations, Clock::now() + std::chrono::milliseconds{duration_ms},
+                typename Types::PRNG{device.random_seed()}, state, model, matrix_node};
+        }
+
+        // search with no deadline (on the opponent's time) until `ponder_hit` or `stop` is called
+        Handle ponder(
+            Types::PRNG &device,
+            const Types::State &state,
+            const Types::Model &model,
+            Types::MatrixNode &matrix_node) const
+        {
+            return Handle{
+                *this, chunk_iterations, Clock::time_point::max(),
+                typename Types::PRNG{device.random_seed()}, state, model, matrix_node};
+        }
+    };
+};
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <types/types.hh>
+#include <algorithm/algorithm.hh>
+
+#include <tree/tree.hh>
+
+#include <chrono>
+#include <vector>
+
+/*
+
+On-policy tree bandit with batched leaf evaluation.
+
+Each batch descends up to `batch_size` paths with the usual `select`, submits all their leaf states
+to a single `model.inference(batch_input, batch_output)` call, and then backs up every path.
+
+A leaf that is already waiting in the current batch is marked with its batch index (pending visit).
+A path that reaches a pending leaf is discarded and the descent is retried, so the batch is made of distinct leaves.
+After `max_collisions` discarded paths the batch is submitted early. For deterministic bandits (e.g. UCB) this
+means the batch size is effectively 1, since there is no virtual loss to push the selection elsewhere.
+
+The search always stops at the first unexpanded node, i.e. `Options::return_after_expand` is ignored.
+
+*/
+
+template <
+    IsBanditAlgorithmTypes Types,
+    template <typename...> typename NodePair = DefaultNodes,
+    typename Options = SearchOptions<>>
+    requires IsBatchModelTypes<Types>
+struct TreeBanditBatched : Types
+{
+    static_assert(std::is_same_v<typename Options::Widening, void>, "only TreeBandit supports progressive widening");
+
+    struct MatrixStats : Types::MatrixStats
+    {
+        // index of this leaf in the current batch, -1 if not awaiting inference
+        int pending_index = -1;
+    };
+    struct ChanceStats : Types::ChanceStats
+    {
+    };
+    using MatrixNode = NodePair<Types, MatrixStats, ChanceStats, typename Options::NodeActions, typename Options::NodeValue>::MatrixNode;
+    using ChanceNode = NodePair<Types, MatrixStats, ChanceStats, typename Options::NodeActions, typename Options::NodeValue>::ChanceNode;
+
+    struct Frame
+    {
+        MatrixNode *matrix_node;
+        ChanceNode *chance_node;
+        typename Types::Outcome outcome;
+    };
+
+    struct Path
+    {
+        std::vector<Frame> frames;
+        MatrixNode *leaf;
+        // -1 if the leaf is terminal
+        int batch_index;
+        size_t rows, cols;
+        typename Types::Value value;
+    };
+
+    // reusable storage for one `run` call
+    struct Workspace
+    {
+        std::vector<Path> paths{};
+        // number of paths gathered in the current batch
+        size_t size = 0;
+        typename Types::ModelBatchInput batch_input{};
+        typename Types::ModelBatchOutput batch_output{};
+        typename Types::ModelOutput model_output{};
+    };
+
+    class Search : public Types::BanditAlgorithm
+    {
+    public:
+        using Types::BanditAlgorithm::BanditAlgorithm;
+
+        Search(const Types::BanditAlgorithm &base) : Types::BanditAlgorithm{base} {}
+
+        Search(const Types::BanditAlgorithm &base, const size_t batch_size)
+            : Types::BanditAlgorithm{base}, batch_size{batch_size}, max_collisions{batch_size} {}
+
+        Search(const Types::BanditAlgorithm &base, const size_t batch_size, const size_t max_collisions)
+            : Types::BanditAlgorithm{base}, batch_size{batch_size}, max_collisions{max_collisions} {}
+
+        const size_t batch_size = 8;
+        const size_t max_collisions = 8;
+
+        friend std::ostream &operator<<(std::ostream &os, const Search &search)
+        {
+            os << "TreeBanditBatched; batch size: " << search.batch_size << " - ";
+            os << static_cast<typename Types::BanditAlgorithm>(search);
+            os << " - " << NodePair<Types, typename Types::MatrixStats, typename Types::ChanceStats>{};
+            return os;
+        }
+
+        size_t run(
+            const size_t duration_ms,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model,
+            MatrixNode &matrix_node) const
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            Workspace workspace{};
+            size_t iterations = 0;
+            while (duration.count() < duration_ms)
+            {
+                iterations += run_batch(batch_size, device, state, model, matrix_node, workspace);
+                end = std::chrono::high_resolution_clock::now();
+                duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            }
+            return iterations;
+        }
+
+        size_t run_for_iterations(
+            const size_t iterations,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model,
+            MatrixNode &matrix_node) const
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+            Workspace workspace{};
+            size_t iteration = 0;
+            while (iteration < iterations)
+            {
+                iteration += run_batch(std::min(batch_size, iterations - iteration), device, state, model, matrix_node, workspace);
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+            const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            return duration.count();
+        }
+
+        // descends up to `max_paths` paths, evaluates their leaves in one batch and backs them up.
+        // returns the number of paths backed up, which is at least 1
+        size_t run_batch(
+            const size_t max_paths,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model,
+            MatrixNode &matrix_node,
+            Workspace &workspace) const
+        {
+            workspace.batch_input.clear();
+            int batch_size = 0;
+            gather(
+                max_paths, device, state, matrix_node, workspace,
+                [&model, &workspace, &batch_size](typename Types::State &&leaf_state)
+                {
+                    model.add_to_batch_input(std::move(leaf_state), workspace.batch_input);
+                    return batch_size++;
+                });
+            if (batch_size > 0)
+            {
+                model.inference(workspace.batch_input, workspace.batch_output);
+            }
+            backup(model, workspace, workspace.batch_output);
+            return workspace.size;
+        }
+
+        // descends up to `max_paths` paths into `workspace.paths`, and sets `workspace.size`.
+        // `add_to_batch(State &&)` is called for each leaf that needs inference and returns its index in the batch
+        template <typename AddToBatch>
+        void gather(
+            const size_t max_paths,
+            Types::PRNG &device,
+            const Types::State &state,
+            MatrixNode &matrix_node,
+            Workspace &workspace,
+            AddToBatch &&add_to_batch) const
+        {
+            std::vector<Path> &paths = workspace.paths;
+            if (paths.size() < max_paths)
+            {
+                paths.resize(max_paths);
+            }
+
+            size_t n_paths = 0;
+            size_t collisions = 0;
+            while (n_paths < max_paths)
+            {
+                typename Types::State state_copy = state;
+                state_copy.randomize_transition(device);
+                Path &path = paths[n_paths];
+                if (!descend(device, state_copy, &matrix_node, path))
+                {
+                    if (++collisions > max_collisions)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                if (path.batch_index == 0)
+                {
+                    path.batch_index = add_to_batch(std::move(state_copy));
+                    path.leaf->stats.pending_index = path.batch_index;
+                }
+                ++n_paths;
+            }
+            workspace.size = n_paths;
+        }
+
+        // expands the leaves of the gathered paths using the batch output and backs up each path
+        void backup(
+            Types::Model &model,
+            Workspace &workspace,
+            Types::ModelBatchOutput &batch_output) const
+        {
+            typename Types::ModelOutput &model_output = workspace.model_output;
+            for (size_t path_idx = 0; path_idx < workspace.size; ++path_idx)
+            {
+                Path &path = workspace.paths[path_idx];
+                MatrixNode *leaf = path.leaf;
+                if (path.batch_index >= 0)
+                {
+                    model.get_output(model_output, batch_output, path.batch_index);
+                    leaf->expand(path.rows, path.cols);
+                    this->expand(leaf->stats, path.rows, path.cols, model_output);
+                    leaf->stats.pending_index = -1;
+                    if constexpr (!std::is_same_v<typename Options::NodeValue, void>)
+                    {
+                        leaf->value = model_output.value;
+                    }
+                    path.value = model_output.value;
+                }
+
+                const int depth = path.frames.size();
+                for (int frame_idx = depth - 1; frame_idx >= 0; --frame_idx)
+                {
+                    Frame &frame = path.frames[frame_idx];
+                    if constexpr (std::is_same_v<typename Options::update_using_average, void>)
+                    {
+                        frame.outcome.value = path.value;
+                    }
+                    else
+                    {
+                        MatrixNode *matrix_node_next = (frame_idx + 1 < depth) ? path.frames[frame_idx + 1].matrix_node : leaf;
+                        this->get_empirical_value(matrix_node_next->stats, frame.outcome.value);
+                    }
+                    this->update_matrix_stats(frame.matrix_node->stats, frame.outcome);
+                    this->update_chance_stats(frame.chance_node->stats, frame.outcome);
+                }
+            }
+        }
+
+    protected:
+        // returns false if the path ends at a leaf that is already pending.
+        // otherwise `path.batch_index` is -1 for a terminal leaf and 0 for a leaf that needs inference
+        bool descend(
+            Types::PRNG &device,
+            Types::State &state,
+            MatrixNode *matrix_node,
+            Path &path) const
+        {
+            path.frames.clear();
+            while (true)
+            {
+                if (state.is_terminal())
+                {
+                    matrix_node->set_terminal();
+                    path.leaf = matrix_node;
+                    path.batch_index = -1;
+                    path.value = state.get_payoff();
+                    return true;
+                }
+                if (!matrix_node->is_expanded())
+                {
+                    path.leaf = matrix_node;
+                    if (matrix_node->stats.pending_index >= 0)
+                    {
+                        return false;
+                    }
+                    if constexpr (!std::is_same_v<typename Options::NodeActions, void>)
+                    {
+                        state.get_actions(
+                            matrix_node->row_actions,
+                            matrix_node->col_actions);
+                        path.rows = matrix_node->row_actions.size();
+                        path.cols = matrix_node->col_actions.size();
+                    }
+                    else
+                    {
+                        path.rows = state.row_actions.size();
+                        path.cols = state.col_actions.size();
+                    }
+                    path.batch_index = 0;
+                    return true;
+                }
+
+                Frame &frame = path.frames.emplace_back();
+                frame.matrix_node = matrix_node;
+                this->select(device, matrix_node->stats, frame.outcome);
+
+                if constexpr (!std::is_same_v<typename Options::NodeActions, void>)
+                {
+                    state.apply_actions(
+                        matrix_node->row_actions[frame.outcome.row_idx],
+                        matrix_node->col_actions[frame.outcome.col_idx]);
+                }
+                else
+                {
+                    state.apply_actions(
+                        state.row_actions[frame.outcome.row_idx],
+                        state.col_actions[frame.outcome.col_idx]);
+                    state.get_actions();
+                }
+
+                frame.chance_node = matrix_node->access(frame.outcome.row_idx, frame.outcome.col_idx);
+                matrix_node = frame.chance_node->access(state.get_obs());
+            }
+        }
+    };
+};
@@ -0,0 +1,430 @@
+#pragma once
+
+#include <libpinyon/math.hh>
+#include <algorithm/algorithm.hh>
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+/*
+
+Multithreaded counterpart to TreeBanditFlat.
+
+All threads share one preallocated array of matrix data and a concurrent open-addressing transition table.
+New nodes take their index from an atomic counter. Once `max_nodes` is reached the tree stops growing,
+and leaves that would have been added are evaluated without being stored.
+
+The table is sized to twice the node capacity so it never needs to be rehashed.
+A slot is claimed by CAS on its index (empty -> busy), the key is written, and then the child index is released.
+Readers that find a busy slot spin until it is released.
+
+Selection reads the stats without locking (like TreeBanditThreaded) and updates lock the per-node mutex.
+The search always stops at the first unexpanded node, i.e. `Options::return_after_expand` is ignored.
+
+*/
+
+template <
+    IsMultithreadedBanditTypes Types,
+    typename Options = SearchOptions<>>
+struct TreeBanditFlatThreaded : Types
+{
+    static_assert(std::is_same_v<typename Options::Widening, void>, "only TreeBandit supports progressive widening");
+
+    struct NodeFlags
+    {
+        typename Types::Mutex mutex{};
+        std::atomic<bool> expanded{false};
+    };
+
+    template <typename MatrixStats, typename NodeActions, typename NodeValue>
+    struct MData : NodeFlags
+    {
+        NodeActions row_actions, col_actions;
+        MatrixStats stats;
+        NodeValue value;
+    };
+
+    template <typename MatrixStats, typename NodeActions>
+    struct MData<MatrixStats, NodeActions, void> : NodeFlags
+    {
+        NodeActions row_actions, col_actions;
+        MatrixStats stats;
+    };
+
+    template <typename MatrixStats, typename NodeValue>
+    struct MData<MatrixStats, void, NodeValue> : NodeFlags
+    {
+        MatrixStats stats;
+        NodeValue value;
+    };
+
+    template <typename MatrixStats>
+    struct MData<MatrixStats, void, void> : NodeFlags
+    {
+        MatrixStats stats;
+    };
+
+    using MatrixData = MData<typename Types::MatrixStats, typename Options::NodeActions, typename Options::NodeValue>;
+
+    class TransitionTable
+    {
+    public:
+        // no more nodes could be allocated for this transition
+        static constexpr uint32_t full = std::numeric_limits<uint32_t>::max();
+
+        TransitionTable(const size_t max_nodes)
+        {
+            size_t capacity = 16;
+            while (capacity < 2 * max_nodes)
+            {
+                capacity <<= 1;
+            }
+            entries = std::make_unique<Entry[]>(capacity);
+            mask = capacity - 1;
+        }
+
+        // returns the child index, allocating it from `counter` if the transition is new
+        uint32_t operator()(
+            const uint32_t parent,
+            const int row_idx,
+            const int col_idx,
+            const uint64_t obs_hash,
+            std::atomic<uint32_t> &counter,
+            const uint32_t max_nodes)
+        {
+            const uint64_t edge = (static_cast<uint64_t>(parent) << 32) | static_cast<uint32_t>(row_idx);
+            size_t slot = math::splitmix64(
+                              edge ^ math::splitmix64(static_cast<uint32_t>(col_idx) ^ math::splitmix64(obs_hash))) &
+                          mask;
+            while (true)
+            {
+                Entry &entry = entries[slot];
+                uint32_t index = entry.index.load(std::memory_order_acquire);
+                if (index == empty)
+                {
+                    // don't claim slots for transitions that can't be stored, or the table could fill.
+                    // a racing thread can still pass this check, so the counter overshoots by at most the thread count
+                    if (counter.load(std::memory_order_relaxed) >= max_nodes)
+                    {
+                        return full;
+                    }
+                    if (!entry.index.compare_exchange_strong(index, busy, std::memory_order_acquire))
+                    {
+                        // lost the race, look at the same slot again
+                        continue;
+                    }
+                    entry.obs_hash = obs_hash;
+                    entry.parent = parent;
+                    entry.row_idx = row_idx;
+                    entry.col_idx = col_idx;
+                    uint32_t child_index = counter.fetch_add(1, std::memory_order_relaxed);
+                    if (child_index >= max_nodes)
+                    {
+                        child_index = full;
+                    }
+                    entry.index.store(child_index, std::memory_order_release);
+                    return child_index;
+                }
+                while (index == busy)
+                {
+                    index = entry.index.load(std::memory_order_acquire);
+                }
+                if (entry.obs_hash == obs_hash && entry.parent == parent &&
+                    entry.row_idx == static_cast<uint32_t>(row_idx) && entry.col_idx == static_cast<uint32_t>(col_idx))
+                {
+                    return index;
+                }
+                slot = (slot + 1) & mask;
+            }
+        }
+
+    private:
+        // the root is never a child, so index 0 marks an empty slot
+        static constexpr uint32_t empty = 0;
+        static constexpr uint32_t busy = full - 1;
+
+        // keys are not packed, so row and col indices of any size can't collide
+        struct Entry
+        {
+            uint64_t obs_hash = 0;
+            uint32_t parent = 0;
+            uint32_t row_idx = 0;
+            uint32_t col_idx = 0;
+            std::atomic<uint32_t> index{empty};
+        };
+
+        std::unique_ptr<Entry[]> entries;
+        size_t mask;
+    };
+
+    class Search : public Types::BanditAlgorithm
+    {
+    public:
+        using Types::BanditAlgorithm::BanditAlgorithm;
+
+        Search(const Types::BanditAlgorithm &base) : Types::BanditAlgorithm{base} {}
+
+        Search(const Types::BanditAlgorithm &base, const size_t threads)
+            : Types::BanditAlgorithm{base}, threads{threads} {}
+
+        Search(const Types::BanditAlgorithm &base, const size_t threads, const size_t max_nodes)
+            : Types::BanditAlgorithm{base}, threads{threads}, max_nodes{max_nodes} {}
+
+        // copies the parameters, not the tree
+        Search(const Search &other)
+            : Types::BanditAlgorithm{other}, threads{other.threads}, max_nodes{other.max_nodes} {}
+
+        const size_t threads = 1;
+        const size_t max_nodes = Options::max_iterations;
+
+        // index 0 is the root
+        std::unique_ptr<MatrixData[]> matrix_data = std::make_unique<MatrixData[]>(max_nodes);
+        std::atomic<uint32_t> matrix_data_size{1};
+
+        TransitionTable transition{max_nodes};
+
+        const Types::ObsHash hash_function{};
+
+        friend std::ostream &operator<<(std::ostream &os, const Search &search)
+        {
+            os << "TreeBanditFlatThreaded; threads: " << search.threads << " - ";
+            os << static_cast<typename Types::BanditAlgorithm>(search);
+            return os;
+        }
+
+        size_t get_size() const
+        {
+            return std::min(static_cast<size_t>(matrix_data_size.load(std::memory_order_relaxed)), max_nodes);
+        }
+
+        // discard the tree
+        void clear()
+        {
+            matrix_data = std::make_unique<MatrixData[]>(max_nodes);
+            matrix_data_size.store(1, std::memory_order_relaxed);
+            transition = TransitionTable{max_nodes};
+        }
+
+        size_t run(
+            const size_t duration_ms,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model)
+        {
+            std::thread thread_pool[threads];
+            size_t iterations[threads];
+            size_t total_iterations = 0;
+            for (int i = 0; i < threads; ++i)
+            {
+                thread_pool[i] = std::thread(
+                    &Search::run_thread, this, duration_ms, device.uniform_64(), &state, &model, std::next(iterations, i));
+            }
+            for (int i = 0; i < threads; ++i)
+            {
+                thread_pool[i].join();
+            }
+            for (int i = 0; i < threads; ++i)
+            {
+                total_iterations += iterations[i];
+            }
+            return total_iterations;
+        }
+
+        size_t run_for_iterations(
+            const size_t iterations,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model)
+        {
+            std::thread thread_pool[threads];
+            const size_t iterations_per_thread = iterations / threads;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < threads; ++i)
+            {
+                thread_pool[i] = std::thread(
+                    &Search::run_thread_for_iterations, this, iterations_per_thread, device.uniform_64(), &state, &model);
+            }
+            for (int i = 0; i < threads; ++i)
+            {
+                thread_pool[i].join();
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+            const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            return duration.count();
+        }
+
+    private:
+        // per thread stacks
+        struct Stack
+        {
+            std::array<typename Types::Outcome, Options::max_depth> outcomes{};
+            std::array<uint32_t, Options::max_depth + 1> matrix_indices{};
+        };
+
+        void run_thread(
+            const size_t duration_ms,
+            const Types::Seed thread_device_seed,
+            const Types::State *state,
+            const Types::Model *model,
+            size_t *iterations)
+        {
+            typename Types::PRNG device_thread(thread_device_seed);
+            typename Types::Model model_thread{*model};
+            typename Types::ModelOutput model_output;
+            Stack stack{};
+
+            const auto start = std::chrono::high_resolution_clock::now();
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            size_t thread_iterations = 0;
+            for (; duration.count() < duration_ms; ++thread_iterations)
+            {
+                typename Types::State state_copy{*state};
+                state_copy.randomize_transition(device_thread);
+                run_iteration(device_thread, state_copy, model_thread, model_output, stack);
+                end = std::chrono::high_resolution_clock::now();
+                duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            }
+            *iterations = thread_iterations;
+        }
+
+        void run_thread_for_iterations(
+            const size_t iterations,
+            const Types::Seed thread_device_seed,
+            const Types::State *state,
+            const Types::Model *model)
+        {
+            typename Types::PRNG device_thread(thread_device_seed);
+            typename Types::Model model_thread{*model};
+            typename Types::ModelOutput model_output;
+            Stack stack{};
+            for (size_t iteration = 0; iteration < iterations; ++iteration)
+            {
+                typename Types::State state_copy{*state};
+                state_copy.randomize_transition(device_thread);
+                run_iteration(device_thread, state_copy, model_thread, model_output, stack);
+            }
+        }
+
+        void run_iteration(
+            Types::PRNG &device,
+            Types::State &state,
+            Types::Model &model,
+            Types::ModelOutput &model_output,
+            Stack &stack)
+        {
+            int depth = 0;
+            uint32_t index = 0;
+            stack.matrix_indices[0] = 0;
+
+            while (true)
+            {
+                if (state.is_terminal())
+                {
+                    model_output.value = state.get_payoff();
+                    break;
+                }
+
+                MatrixData &data = matrix_data[index];
+
+                if (!data.expanded.load(std::memory_order_acquire))
+                {
+                    data.mutex.lock();
+                    if (!data.expanded.load(std::memory_order_relaxed))
+                    {
+                        size_t rows, cols;
+                        if constexpr (!std::is_same_v<typename Options::NodeActions, void>)
+                        {
+                            state.get_actions(data.row_actions, data.col_actions);
+                            rows = data.row_actions.size();
+                            cols = data.col_actions.size();
+                        }
+                        else
+                        {
+                            rows = state.row_actions.size();
+                            cols = state.col_actions.size();
+                        }
+                        model.inference(std::move(state), model_output);
+                        this->expand(data.stats, rows, cols, model_output);
+                        if constexpr (!std::is_same_v<typename Options::NodeValue, void>)
+                        {
+                            data.value = model_output.value;
+                        }
+                        data.expanded.store(true, std::memory_order_release);
+                        data.mutex.unlock();
+                        break;
+                    }
+                    data.mutex.unlock();
+                }
+
+                if (depth >= Options::max_depth)
+                {
+                    model.inference(std::move(state), model_output);
+                    break;
+                }
+
+                typename Types::Outcome &outcome = stack.outcomes[depth];
+                this->select(device, data.stats, outcome);
+
+                if constexpr (!std::is_same_v<typename Options::NodeActions, void>)
+                {
+                    state.apply_actions(
+                        data.row_actions[outcome.row_idx],
+                        data.col_actions[outcome.col_idx]);
+                }
+                else
+                {
+                    state.apply_actions(
+                        state.row_actions[outcome.row_idx],
+                        state.col_actions[outcome.col_idx]);
+                    state.get_actions();
+                }
+
+                index = transition(
+                    index, outcome.row_idx, outcome.col_idx,
+                    static_cast<uint64_t>(hash_function(state.get_obs())),
+                    matrix_data_size, max_nodes);
+                stack.matrix_indices[++depth] = index;
+
+                if (index == TransitionTable::full)
+                {
+                    if (state.is_terminal())
+                    {
+                        model_output.value = state.get_payoff();
+                    }
+                    else
+                    {
+                        model.inference(std::move(state), model_output);
+                    }
+                    break;
+                }
+            }
+
+            for (int d = depth - 1; d >= 0; --d)
+            {
+                typename Types::Outcome &outcome = stack.outcomes[d];
+                const uint32_t child_index = stack.matrix_indices[d + 1];
+                if constexpr (std::is_same_v<typename Options::update_using_average, void>)
+                {
+                    outcome.value = model_output.value;
+                }
+                else
+                {
+                    if (child_index == TransitionTable::full)
+                    {
+                        outcome.value = model_output.value;
+                    }
+                    else
+                    {
+                        this->get_empirical_value(matrix_data[child_index].stats, outcome.value);
+                    }
+                }
+                MatrixData &data = matrix_data[stack.matrix_indices[d]];
+                this->update_matrix_stats(data.stats, outcome, data.mutex);
+            }
+        }
+    };
+};
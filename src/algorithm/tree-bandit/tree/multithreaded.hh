@@ -15,6 +15,8 @@ template <
     typename Options = SearchOptions<>>
 struct TreeBanditThreaded : Types
 {
+    static_assert(std::is_same_v<typename Options::Widening, void>, "only TreeBandit supports progressive widening");
+
     struct MatrixStats : Types::MatrixStats
     {
         typename Types::Mutex stats_mutex{};
@@ -254,6 +256,8 @@ template <
     typename Options = SearchOptions<>>
 struct TreeBanditThreadPool : Types
 {
+    static_assert(std::is_same_v<typename Options::Widening, void>, "only TreeBandit supports progressive widening");
+
     struct MatrixStats : Types::MatrixStats
     {
         int mutex_index = 0;
@@ -4,6 +4,28 @@
 #include <tree/tree.hh>
 #include <algorithm/algorithm.hh>
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+
+/*
+
+Actor/learner search over many roots at once, intended for batched (GPU) inference.
+
+The roots are partitioned among `threads` actor threads. Each actor has two reusable trajectory batches.
+While the inference thread evaluates the batch an actor just submitted, the actor gathers trajectories into the
+other one, then waits for the first batch and backs it up. So the tree side and the model side run concurrently.
+
+The leaves of a batch that is still being evaluated are expanded (state part) but not properly expanded,
+so later trajectories that pass through them select uniformly, which the off-policy update accounts for.
+
+The model's batched `inference` is only called from the inference thread. The actors share the same model
+object but only call `add_to_batch_input` and `get_output`.
+
+*/
+
 template <
     IsBanditAlgorithmTypes Types,
     template <typename...> typename NodePair = DefaultNodes,
@@ -34,6 +56,104 @@ struct OffPolicy : Types
         std::vector<Frame> frames;
     };
 
+    // trajectories and frames are cleared rather than freed, so their storage is reused every round
+    struct TrajectoryBatch
+    {
+        std::vector<Trajectory> trajectories{};
+        size_t size = 0;
+        typename Types::ModelBatchInput input{};
+        typename Types::ModelBatchOutput output{};
+        // guarded by the inference queue mutex
+        bool ready = false;
+
+        void clear()
+        {
+            size = 0;
+            input.clear();
+        }
+
+        Trajectory &next()
+        {
+            if (size == trajectories.size())
+            {
+                trajectories.emplace_back();
+            }
+            Trajectory &trajectory = trajectories[size++];
+            trajectory.frames.clear();
+            return trajectory;
+        }
+    };
+
+    class InferenceQueue
+    {
+    public:
+        InferenceQueue(Types::Model &model) : model{model}
+        {
+            thread = std::thread(&InferenceQueue::run_thread, this);
+        }
+
+        ~InferenceQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                stop = true;
+            }
+            submitted.notify_one();
+            thread.join();
+        }
+
+        void submit(TrajectoryBatch &batch)
+        {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                batch.ready = false;
+                queue.push_back(&batch);
+            }
+            submitted.notify_one();
+        }
+
+        void wait(TrajectoryBatch &batch)
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            done.wait(lock, [&batch]
+                      { return batch.ready; });
+        }
+
+    private:
+        Types::Model &model;
+        std::mutex mutex{};
+        std::condition_variable submitted{};
+        std::condition_variable done{};
+        std::deque<TrajectoryBatch *> queue{};
+        bool stop = false;
+        std::thread thread{};
+
+        void run_thread()
+        {
+            while (true)
+            {
+                TrajectoryBatch *batch;
+                {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    submitted.wait(lock, [this]
+                                   { return stop || !queue.empty(); });
+                    if (queue.empty())
+                    {
+                        return;
+                    }
+                    batch = queue.front();
+                    queue.pop_front();
+                }
+                model.inference(batch->input, batch->output);
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    batch->ready = true;
+                }
+                done.notify_all();
+            }
+        }
+    };
+
     class Search : public Types::BanditAlgorithm
     {
     public:
@@ -41,43 +161,45 @@ struct OffPolicy : Types
 
         Search(const Types::BanditAlgorithm &base) : Types::BanditAlgorithm{base} {}
 
+        Search(const Types::BanditAlgorithm &base, const size_t threads) : Types::BanditAlgorithm{base}, threads{threads} {}
+
+        // actor threads. There is always one additional inference thread
+        const size_t threads = 1;
+
         friend std::ostream &operator<<(std::ostream &os, const Search &search)
         {
-            os << "OffPolicy - ";
+            os << "OffPolicy; threads: " << search.threads << " - ";
             os << static_cast<typename Types::BanditAlgorithm>(search);
             os << " - " << NodePair<Types, typename Types::MatrixStats, typename Types::ChanceStats>{};
             return os;
         }
 
+        // returns the total number of batches (learner iterations) over all actors
         size_t run(
             const size_t duration_ms,
             const size_t actor_iterations_per,
             Types::PRNG &device,
             const std::vector<typename Types::State> &states,
             Types::Model &model,
-            std::vector<MatrixNode> &matrix_nodes)
+            std::vector<MatrixNode> &matrix_nodes) const
         {
-            auto start = std::chrono::high_resolution_clock::now();
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-            std::vector<Trajectory> trajectories{};
-
-            size_t iterations = 0;
-            for (; duration.count() < duration_ms; ++iterations)
+            InferenceQueue inference_queue{model};
+            std::thread thread_pool[threads];
+            size_t iterations[threads];
+            const auto deadline = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds{duration_ms};
+            for (int i = 0; i < threads; ++i)
             {
-                trajectories.clear();
-                typename Types::ModelBatchInput model_batch_input{};
-                get_trajectories(trajectories, model_batch_input,
-                                 actor_iterations_per, device, states, model, matrix_nodes);
-
-                typename Types::ModelBatchOutput model_batch_output{};
-                model.inference(model_batch_input, model_batch_output);
-
-                update_using_trajectories(model, trajectories, model_batch_output);
-                duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+                thread_pool[i] = std::thread(
+                    &Search::run_actor, this, std::numeric_limits<size_t>::max(), deadline, actor_iterations_per, device.uniform_64(),
+                    &states, &model, &matrix_nodes, i, &inference_queue, std::next(iterations, i));
+            }
+            size_t total_iterations = 0;
+            for (int i = 0; i < threads; ++i)
+            {
+                thread_pool[i].join();
+                total_iterations += iterations[i];
             }
-            return iterations;
+            return total_iterations;
         }
 
         size_t run_for_iterations(
@@ -86,41 +208,87 @@ struct OffPolicy : Types
             Types::PRNG &device,
             const std::vector<typename Types::State> &states,
             Types::Model &model,
-            std::vector<MatrixNode> &matrix_nodes)
+            std::vector<MatrixNode> &matrix_nodes) const
         {
-            std::vector<Trajectory> trajectories{};
-
-            auto start = std::chrono::high_resolution_clock::now();
-            for (int learner_iteration = 0; learner_iteration < learner_iterations; ++learner_iteration)
+            const auto start = std::chrono::high_resolution_clock::now();
             {
-                trajectories.clear();
-                typename Types::ModelBatchInput model_batch_input{};
-                get_trajectories(trajectories, model_batch_input,
-                                 actor_iterations_per, device, states, model, matrix_nodes);
+                InferenceQueue inference_queue{model};
+                std::thread thread_pool[threads];
+                size_t iterations[threads];
+                for (int i = 0; i < threads; ++i)
+                {
+                    thread_pool[i] = std::thread(
+                        &Search::run_actor, this, learner_iterations, std::chrono::high_resolution_clock::time_point::max(),
+                        actor_iterations_per, device.uniform_64(),
+                        &states, &model, &matrix_nodes, i, &inference_queue, std::next(iterations, i));
+                }
+                for (int i = 0; i < threads; ++i)
+                {
+                    thread_pool[i].join();
+                }
+            }
+            const auto end = std::chrono::high_resolution_clock::now();
+            const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            return duration.count();
+        }
 
-                typename Types::ModelBatchOutput model_batch_output{};
-                model.inference(model_batch_input, model_batch_output);
+        void run_actor(
+            const size_t learner_iterations,
+            const std::chrono::high_resolution_clock::time_point deadline,
+            const size_t actor_iterations_per,
+            const Types::Seed thread_device_seed,
+            const std::vector<typename Types::State> *states,
+            const Types::Model *model,
+            std::vector<MatrixNode> *matrix_nodes,
+            const size_t thread_index,
+            InferenceQueue *inference_queue,
+            size_t *iterations) const
+        {
+            typename Types::PRNG device_thread{thread_device_seed};
+            const size_t begin = thread_index * matrix_nodes->size() / threads;
+            const size_t end = (thread_index + 1) * matrix_nodes->size() / threads;
 
-                update_using_trajectories(model, trajectories, model_batch_output);
+            TrajectoryBatch batches[2];
+            TrajectoryBatch *previous = nullptr;
+            size_t learner_iteration = 0;
+            for (; learner_iteration < learner_iterations &&
+                   std::chrono::high_resolution_clock::now() < deadline;
+                 ++learner_iteration)
+            {
+                TrajectoryBatch &current = batches[learner_iteration & 1];
+                get_trajectories(current, actor_iterations_per, device_thread,
+                                 *states, *model, *matrix_nodes, begin, end);
+                inference_queue->submit(current);
+                if (previous != nullptr)
+                {
+                    inference_queue->wait(*previous);
+                    update_using_trajectories(*model, *previous);
+                }
+                previous = &current;
             }
-            auto end = std::chrono::high_resolution_clock::now();
-            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-            return duration.count();
+            if (previous != nullptr)
+            {
+                inference_queue->wait(*previous);
+                update_using_trajectories(*model, *previous);
+            }
+            *iterations = learner_iteration;
         }
 
         void get_trajectories(
-            // output parameters
-            std::vector<Trajectory> &trajectories,
-            Types::ModelBatchInput &input,
+            // output parameter
+            TrajectoryBatch &batch,
             // normal tree bandit params
             size_t actor_iterations_per,
             Types::PRNG &device,
             const std::vector<typename Types::State> &states,
-            Types::Model &model,
-            std::vector<MatrixNode> &matrix_nodes)
+            const Types::Model &model,
+            std::vector<MatrixNode> &matrix_nodes,
+            // range of roots owned by this actor
+            const size_t begin,
+            const size_t end) const
         {
-            // One inference step
-            for (int index = 0; index < matrix_nodes.size(); ++index)
+            batch.clear();
+            for (size_t index = begin; index < end; ++index)
             {
                 MatrixNode *matrix_node = &matrix_nodes[index];
                 const typename Types::State &state = states[index];
@@ -128,18 +296,18 @@ struct OffPolicy : Types
 
                 for (size_t actor_iteration = 0; actor_iteration < actor_iterations_per; ++actor_iteration)
                 {
-                    trajectories.emplace_back();
-                    Trajectory &trajectory = trajectories.back();
+                    Trajectory &trajectory = batch.next();
                     // trajectory is a flat vector over matrix nodes and input iterations per
 
                     auto state_copy = state;
+                    state_copy.randomize_transition(device);
                     get_trajectory(trajectory,
-                                   device, state_copy, model, matrix_node);
+                                   device, state_copy, matrix_node);
                     // populate vector of frames, rollout state to leaf node
 
                     if (!state_copy.is_terminal())
                     {
-                        model.add_to_batch_input(std::move(state_copy), input);
+                        model.add_to_batch_input(std::move(state_copy), batch.input);
                     }
                     // then add leaf state to inference pile
                 }
@@ -147,13 +315,15 @@ struct OffPolicy : Types
         }
 
         void update_using_trajectories(
-            typename Types::Model &model,
-            std::vector<Trajectory> &trajectories,
-            Types::ModelBatchOutput &model_batch_output)
+            const typename Types::Model &model,
+            TrajectoryBatch &batch) const
         {
+            // only non-terminal leaves were added to the batch input
             int index = 0;
-            for (Trajectory &trajectory : trajectories)
+            typename Types::ModelOutput model_output{};
+            for (size_t trajectory_idx = 0; trajectory_idx < batch.size; ++trajectory_idx)
             {
+                Trajectory &trajectory = batch.trajectories[trajectory_idx];
                 Frame &leaf_frame = trajectory.frames.front();
                 MatrixStats &leaf_stats = leaf_frame.matrix_node->stats;
 
@@ -164,8 +334,7 @@ struct OffPolicy : Types
                 }
                 else [[likely]]
                 {
-                    typename Types::ModelOutput model_output{};
-                    model.get_output(model_output, model_batch_output, index);
+                    model.get_output(model_output, batch.output, index++);
                     leaf_value = model_output.value;
                     if (!leaf_stats.properly_expanded)
                     {
@@ -174,15 +343,10 @@ struct OffPolicy : Types
                     }
                 }
 
-                int frame_index = 0;
-                for (Frame &frame : trajectory.frames)
+                // skip the leaf frame, which has no outcome
+                for (size_t frame_index = 1; frame_index < trajectory.frames.size(); ++frame_index)
                 {
-                    if (frame_index == 0)
-                    {
-                        frame_index++;
-                        continue;
-                    } // skip last frame in trajectory
-
+                    Frame &frame = trajectory.frames[frame_index];
                     frame.outcome.value = leaf_value;
                     this->update_matrix_stats_offpolicy(
                         frame.matrix_node->stats,
@@ -198,8 +362,7 @@ struct OffPolicy : Types
             // normal run_iteration args
             Types::PRNG &device,
             Types::State &state,
-            Types::Model &model,
-            MatrixNode *matrix_node)
+            MatrixNode *matrix_node) const
         {
             Frame frame{matrix_node};
 
@@ -210,6 +373,9 @@ struct OffPolicy : Types
             }
             else
             {
+                // get_actions called here before add_to_batch_input();
+                // we need this to have valid action data when it gets there, for policy masking
+                state.get_actions();
                 if (!matrix_node->is_expanded())
                 {
                     const size_t rows = state.row_actions.size();
@@ -219,8 +385,6 @@ struct OffPolicy : Types
                 }
                 else
                 {
-                    state.get_actions(); // get_actions called here before add_to_batch_input();
-                    // we need this to have valid action data when it gets there, for policy masking
                     if (matrix_node->stats.properly_expanded)
                     {
                         this->select(device, matrix_node->stats, frame.outcome);
@@ -240,7 +404,7 @@ struct OffPolicy : Types
                     ChanceNode *chance_node = matrix_node->access(frame.outcome.row_idx, frame.outcome.col_idx);
                     MatrixNode *matrix_node_next = chance_node->access(state.get_obs());
 
-                    get_trajectory(trajectory, device, state, model, matrix_node_next);
+                    get_trajectory(trajectory, device, state, matrix_node_next);
                 }
             }
 
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm/tree-bandit/tree/batched.hh>
+
+#include <thread>
+#include <mutex>
+#include <barrier>
+#include <memory>
+
+/*
+
+Batched tree bandit search over many independent roots, e.g. one per concurrent self-play game.
+
+The scheduler owns the (state, root) pairs. Each round, every root that has not reached its iteration budget
+gathers up to `batch_size` paths using `TreeBanditBatched`. The leaves from all roots are added to one shared batch,
+so there is a single `model.inference` call per round. Then each root backs up its own paths.
+
+Roots are statically assigned to `threads` worker threads, and the calling thread runs inference between phases.
+Since no root is shared between workers, the trees need no locking.
+
+The callback is invoked on the calling thread, after the round in which a root reaches its budget.
+
+*/
+
+template <
+    IsBanditAlgorithmTypes Types,
+    template <typename...> typename NodePair = DefaultNodes,
+    typename Options = SearchOptions<>>
+    requires IsBatchModelTypes<Types>
+struct SearchScheduler : TreeBanditBatched<Types, NodePair, Options>
+{
+    using Batched = TreeBanditBatched<Types, NodePair, Options>;
+
+    struct Root
+    {
+        Root(const Types::State &state, const size_t budget, const Types::Seed seed)
+            : state{state}, budget{budget}, device{seed} {}
+
+        const typename Types::State state;
+        const size_t budget;
+        typename Types::PRNG device;
+        typename Batched::MatrixNode matrix_node{};
+        typename Batched::Workspace workspace{};
+        size_t iterations = 0;
+        bool reported = false;
+    };
+
+    class Search : public Batched::Search
+    {
+    public:
+        Search(const Batched::Search &base) : Batched::Search{base} {}
+
+        Search(const Batched::Search &base, const size_t threads) : Batched::Search{base}, threads{threads} {}
+
+        // copies the parameters, not the roots
+        Search(const Search &other) : Batched::Search{other}, threads{other.threads} {}
+
+        const size_t threads = 1;
+
+        friend std::ostream &operator<<(std::ostream &os, const Search &search)
+        {
+            os << "SearchScheduler; threads: " << search.threads << " - ";
+            os << static_cast<const typename Batched::Search &>(search);
+            return os;
+        }
+
+        // returns the index of the new root. Must not be called during `run`
+        size_t add_root(
+            const Types::State &state,
+            const size_t iterations,
+            Types::PRNG &device)
+        {
+            roots.emplace_back(std::make_unique<Root>(state, iterations, device.random_seed()));
+            return roots.size() - 1;
+        }
+
+        size_t get_size() const
+        {
+            return roots.size();
+        }
+
+        Root &get_root(const size_t index)
+        {
+            return *roots[index];
+        }
+
+        const Root &get_root(const size_t index) const
+        {
+            return *roots[index];
+        }
+
+        void clear()
+        {
+            roots.clear();
+        }
+
+        // searches every root until it reaches its budget. Returns the number of inference calls
+        size_t run(Types::Model &model)
+        {
+            return run(model, [](const size_t, Root &) {});
+        }
+
+        // `callback(size_t index, Root &root)` is called once for each root that reaches its budget
+        template <typename Callback>
+        size_t run(Types::Model &model, Callback &&callback)
+        {
+            const size_t n_threads = std::max(size_t{1}, std::min(threads, roots.size()));
+            Batch batch{};
+            std::barrier sync{static_cast<std::ptrdiff_t>(n_threads + 1)};
+            bool stop = false;
+
+            std::thread thread_pool[n_threads];
+            for (size_t i = 0; i < n_threads; ++i)
+            {
+                thread_pool[i] = std::thread(
+                    &Search::run_thread, this, i, n_threads, &model, &batch, &sync, &stop);
+            }
+
+            size_t inference_calls = 0;
+            while (!stop)
+            {
+                // gathered
+                sync.arrive_and_wait();
+                if (batch.size > 0)
+                {
+                    model.inference(batch.input, batch.output);
+                    ++inference_calls;
+                }
+                // inference done
+                sync.arrive_and_wait();
+                // backed up
+                sync.arrive_and_wait();
+
+                stop = true;
+                for (size_t index = 0; index < roots.size(); ++index)
+                {
+                    Root &root = *roots[index];
+                    if (root.reported)
+                    {
+                        continue;
+                    }
+                    if (root.iterations >= root.budget)
+                    {
+                        root.reported = true;
+                        callback(index, root);
+                    }
+                    else
+                    {
+                        stop = false;
+                    }
+                }
+                batch.input.clear();
+                batch.size = 0;
+                // next round or stop
+                sync.arrive_and_wait();
+            }
+
+            for (size_t i = 0; i < n_threads; ++i)
+            {
+                thread_pool[i].join();
+            }
+            return inference_calls;
+        }
+
+    private:
+        std::vector<std::unique_ptr<Root>> roots{};
+
+        struct Batch
+        {
+            std::mutex mutex{};
+            typename Types::ModelBatchInput input{};
+            typename Types::ModelBatchOutput output{};
+            int size = 0;
+        };
+
+        void run_thread(
+            const size_t thread_index,
+            const size_t n_threads,
+            Types::Model *model,
+            Batch *batch,
+            std::barrier<> *sync,
+            const bool *stop)
+        {
+            auto add_to_batch = [model, batch](typename Types::State &&state)
+            {
+                std::lock_guard<std::mutex> lock{batch->mutex};
+                model->add_to_batch_input(std::move(state), batch->input);
+                return batch->size++;
+            };
+
+            while (true)
+            {
+                for (size_t index = thread_index; index < roots.size(); index += n_threads)
+                {
+                    Root &root = *roots[index];
+                    if (root.iterations >= root.budget)
+                    {
+                        continue;
+                    }
+                    const size_t max_paths = std::min(this->batch_size, root.budget - root.iterations);
+                    this->gather(max_paths, root.device, root.state, root.matrix_node, root.workspace, add_to_batch);
+                }
+                sync->arrive_and_wait();
+                sync->arrive_and_wait();
+
+                for (size_t index = thread_index; index < roots.size(); index += n_threads)
+                {
+                    Root &root = *roots[index];
+                    if (root.iterations >= root.budget)
+                    {
+                        continue;
+                    }
+                    this->backup(*model, root.workspace, batch->output);
+                    root.iterations += root.workspace.size;
+                }
+                sync->arrive_and_wait();
+                sync->arrive_and_wait();
+
+                if (*stop)
+                {
+                    break;
+                }
+            }
+        }
+    };
+};
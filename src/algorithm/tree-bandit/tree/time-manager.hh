@@ -0,0 +1,246 @@
+#pragma once
+
+#include <libpinyon/math.hh>
+#include <types/matrix.hh>
+#include <algorithm/algorithm.hh>
+
+#include <chrono>
+#include <cmath>
+
+/*
+
+Time management wrapper for the tree bandit searches.
+
+`run` searches in chunks of `run_for_iterations` and checks the root after each chunk.
+The search stops before `duration_ms` if, after `min_fraction` of the time has passed, either
+
+* the most visited row and column actions lead by more visits than could be made in the remaining time, or
+* the L1 change in the root empirical strategies has been below `strategy_tolerance` for `stable_checks` chunks
+  (and, for bandits with an `Exp3Fat` style empirical matrix, the exploitability of the root strategies on
+  that matrix is below `max_exploitability`)
+
+If the root is still not settled at `duration_ms`, the search is extended by up to `max_extension` times the duration.
+
+`run_for_iteration_budget` applies the same rules with time measured in iterations,
+so that the point where the search stops is reproducible.
+
+*/
+
+template <IsSearchTypes Types>
+struct TimeManaged : Types
+{
+    struct Settings
+    {
+        size_t chunk_iterations = 1 << 8;
+        double min_fraction = .25;
+        double max_extension = 0;
+        double strategy_tolerance = .01;
+        size_t stable_checks = 4;
+        // only used if the root stats have an empirical payoff matrix. 1 disables the check
+        double max_exploitability = 1;
+    };
+
+    class Search : public Types::Search
+    {
+    public:
+        using Types::Search::Search;
+
+        Search(const Types::Search &base) : Types::Search{base} {}
+
+        Search(const Types::Search &base, const Settings &settings) : Types::Search{base}, settings{settings} {}
+
+        Settings settings{};
+
+        friend std::ostream &operator<<(std::ostream &os, const Search &search)
+        {
+            os << "TimeManaged; chunk iterations: " << search.settings.chunk_iterations << " - ";
+            os << static_cast<const typename Types::Search &>(search);
+            return os;
+        }
+
+        size_t run(
+            const size_t duration_ms,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model,
+            Types::MatrixNode &matrix_node)
+        {
+            using Clock = std::chrono::high_resolution_clock;
+            const auto start = Clock::now();
+            return run_managed(
+                duration_ms,
+                [start](size_t)
+                { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); },
+                device, state, model, matrix_node);
+        }
+
+        size_t run_for_iteration_budget(
+            const size_t budget,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model,
+            Types::MatrixNode &matrix_node)
+        {
+            return run_managed(
+                budget,
+                [](size_t iterations)
+                { return static_cast<double>(iterations); },
+                device, state, model, matrix_node);
+        }
+
+        // fills `value_matrix` with the root payoffs unfolded from an Exp3Fat style empirical matrix.
+        // returns false if the stats do not have one
+        bool get_empirical_matrix(
+            const Types::MatrixStats &stats,
+            DataMatrix<PairReal<typename Types::Real>> &value_matrix) const
+        {
+            if constexpr (
+                Types::Value::IS_CONSTANT_SUM &&
+                requires(const Types::MatrixStats &stats) {
+                    stats.matrix.get(0, 0).cum_row_value;
+                    stats.matrix.get(0, 0).count;
+                })
+            {
+                // Exp3Fat folds the matrix along the diagonal, which only makes sense for symmetric games
+                const size_t size = stats.matrix.rows;
+                if (stats.matrix.cols != size)
+                {
+                    return false;
+                }
+                using Real = typename Types::Real;
+                value_matrix.fill(size, size);
+                for (size_t row_idx = 0; row_idx < size; ++row_idx)
+                {
+                    for (size_t col_idx = 0; col_idx < size; ++col_idx)
+                    {
+                        const bool folded = row_idx > col_idx;
+                        const auto &data = folded ? stats.matrix.get(col_idx, row_idx) : stats.matrix.get(row_idx, col_idx);
+                        const Real mean{data.count > 0 ? data.cum_row_value / Real{data.count} : Real{Rational<>{1, 2}}};
+                        const Real row_value{folded ? Real{mean * -1 + 1} : mean};
+                        value_matrix.get(row_idx, col_idx) = PairReal<Real>{row_value, Real{row_value * -1 + 1}};
+                    }
+                }
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+    private:
+        // `elapsed(iterations)` is the time used so far, in the same units as `duration`
+        template <typename Elapsed>
+        size_t run_managed(
+            const size_t duration,
+            Elapsed elapsed,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model,
+            Types::MatrixNode &matrix_node)
+        {
+            const double min_duration = settings.min_fraction * duration;
+            const double max_duration = (1 + settings.max_extension) * duration;
+
+            typename Types::VectorReal row_strategy, col_strategy, prev_row_strategy, prev_col_strategy;
+            size_t iterations = 0;
+            size_t stable = 0;
+            while (true)
+            {
+                this->run_for_iterations(settings.chunk_iterations, device, state, model, matrix_node);
+                iterations += settings.chunk_iterations;
+                const double elapsed_duration = elapsed(iterations);
+
+                this->get_empirical_strategies(matrix_node.stats, row_strategy, col_strategy);
+                if (row_strategy.size() == prev_row_strategy.size() &&
+                    col_strategy.size() == prev_col_strategy.size() &&
+                    l1_distance(row_strategy, prev_row_strategy) + l1_distance(col_strategy, prev_col_strategy) <
+                        settings.strategy_tolerance)
+                {
+                    ++stable;
+                }
+                else
+                {
+                    stable = 0;
+                }
+                std::swap(row_strategy, prev_row_strategy);
+                std::swap(col_strategy, prev_col_strategy);
+
+                if (elapsed_duration >= max_duration)
+                {
+                    break;
+                }
+
+                const bool settled = stable >= settings.stable_checks &&
+                                     is_unexploitable(matrix_node.stats, prev_row_strategy, prev_col_strategy);
+                if (elapsed_duration >= duration && (settled || settings.max_extension == 0))
+                {
+                    break;
+                }
+                if (elapsed_duration < min_duration)
+                {
+                    continue;
+                }
+
+                // root visits are at least the iterations of this call, so the lead is underestimated
+                const double deadline = elapsed_duration < duration ? duration : max_duration;
+                const double remaining = iterations / elapsed_duration * (deadline - elapsed_duration);
+                if (settled ||
+                    (lead(prev_row_strategy) * iterations > remaining && lead(prev_col_strategy) * iterations > remaining))
+                {
+                    break;
+                }
+            }
+            return iterations;
+        }
+
+        static double l1_distance(const Types::VectorReal &x, const Types::VectorReal &y)
+        {
+            double distance = 0;
+            for (size_t i = 0; i < x.size(); ++i)
+            {
+                distance += std::abs(math::to_double(x[i]) - math::to_double(y[i]));
+            }
+            return distance;
+        }
+
+        // difference between the largest and second largest entries
+        static double lead(const Types::VectorReal &strategy)
+        {
+            double first = 0, second = 0;
+            for (size_t i = 0; i < strategy.size(); ++i)
+            {
+                const double x = math::to_double(strategy[i]);
+                if (x > first)
+                {
+                    second = first;
+                    first = x;
+                }
+                else if (x > second)
+                {
+                    second = x;
+                }
+            }
+            return first - second;
+        }
+
+        bool is_unexploitable(
+            const Types::MatrixStats &stats,
+            const Types::VectorReal &row_strategy,
+            const Types::VectorReal &col_strategy) const
+        {
+            if (settings.max_exploitability >= 1)
+            {
+                return true;
+            }
+            DataMatrix<PairReal<typename Types::Real>> value_matrix{};
+            if (!get_empirical_matrix(stats, value_matrix) ||
+                value_matrix.rows != row_strategy.size() || value_matrix.cols != col_strategy.size())
+            {
+                return true;
+            }
+            const auto expl = math::exploitability(value_matrix, row_strategy, col_strategy);
+            return math::to_double(expl) <= settings.max_exploitability;
+        }
+    };
+};
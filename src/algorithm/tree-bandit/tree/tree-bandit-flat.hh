@@ -1,12 +1,40 @@
-#include <unordered_map>
+#pragma once
+
+#include <libpinyon/math.hh>
+#include <algorithm/algorithm.hh>
+
+#include <chrono>
+#include <vector>
+
+/*
+
+Tree bandit search without node objects. Matrix data is stored contiguously and indexed in order of creation,
+and the children of a node are found with a transition table keyed on (parent index, row idx, col idx, obs hash).
+
+The data vector and the table both grow as needed, so `Options::max_iterations` is only the initial capacity.
+The tree persists between calls to `run` or `run_for_iterations`; call `clear` before searching a different state.
+
+Chance stats are not stored.
+
+*/
 
 template <
     typename Types,
     typename Options = SearchOptions<>>
 struct TreeBanditFlat : Types
 {
+    static_assert(std::is_same_v<typename Options::Widening, void>, "only TreeBandit supports progressive widening");
+
+    struct NodeFlags
+    {
+        // model inference has been called on this node
+        bool seen = false;
+        // bandit stats have been sized to the actions
+        bool expanded = false;
+    };
+
     template <typename MatrixStats, typename NodeActions, typename NodeValue>
-    struct MData
+    struct MData : NodeFlags
     {
         NodeActions row_actions, col_actions;
         MatrixStats stats;
@@ -14,27 +42,141 @@ struct TreeBanditFlat : Types
     };
 
     template <typename MatrixStats, typename NodeActions>
-    struct MData<MatrixStats, NodeActions, void>
+    struct MData<MatrixStats, NodeActions, void> : NodeFlags
     {
         NodeActions row_actions, col_actions;
         MatrixStats stats;
     };
 
     template <typename MatrixStats, typename NodeValue>
-    struct MData<MatrixStats, void, NodeValue>
+    struct MData<MatrixStats, void, NodeValue> : NodeFlags
     {
         MatrixStats stats;
         NodeValue value;
     };
 
     template <typename MatrixStats>
-    struct MData<MatrixStats, void, void>
+    struct MData<MatrixStats, void, void> : NodeFlags
     {
         MatrixStats stats;
     };
 
     using MatrixData = MData<typename Types::MatrixStats, typename Options::NodeActions, typename Options::NodeValue>;
 
+    /*
+    Open addressing with linear probing and a power-of-two capacity, rehashed at half load.
+    Keys are compared exactly, rather than trusting a single 64 bit hash of the whole key.
+    Child index 0 is the root, which is never a child, so it marks an empty slot.
+    */
+    class TransitionTable
+    {
+    public:
+        TransitionTable(const size_t min_size)
+        {
+            reset(min_size);
+        }
+
+        void reset(const size_t min_size)
+        {
+            size_t capacity = 16;
+            while (capacity < 2 * min_size)
+            {
+                capacity <<= 1;
+            }
+            entries.assign(capacity, Entry{});
+            mask = capacity - 1;
+            size = 0;
+        }
+
+        // reference to the child index for this transition. If it is 0 then the transition is new and
+        // the caller must write the new (non-zero) index
+        uint32_t &operator()(
+            const uint32_t parent,
+            const int row_idx,
+            const int col_idx,
+            const uint64_t obs_hash)
+        {
+            if (2 * (size + 1) > entries.size())
+            {
+                grow();
+            }
+            const Entry key{obs_hash, parent, static_cast<uint32_t>(row_idx), static_cast<uint32_t>(col_idx)};
+            size_t slot = hash(key) & mask;
+            while (true)
+            {
+                Entry &entry = entries[slot];
+                if (entry.index == 0)
+                {
+                    entry = key;
+                    ++size;
+                    return entry.index;
+                }
+                if (entry.has_key(key))
+                {
+                    return entry.index;
+                }
+                slot = (slot + 1) & mask;
+            }
+        }
+
+        size_t get_size() const
+        {
+            return size;
+        }
+
+        size_t get_capacity() const
+        {
+            return entries.size();
+        }
+
+    private:
+        // the action indices are stored whole rather than packed, so any number of actions is keyed exactly
+        struct Entry
+        {
+            uint64_t obs_hash = 0;
+            uint32_t parent = 0;
+            uint32_t row_idx = 0;
+            uint32_t col_idx = 0;
+            uint32_t index = 0;
+
+            bool has_key(const Entry &key) const
+            {
+                return obs_hash == key.obs_hash && parent == key.parent &&
+                       row_idx == key.row_idx && col_idx == key.col_idx;
+            }
+        };
+
+        std::vector<Entry> entries{};
+        size_t mask = 0;
+        size_t size = 0;
+
+        static inline uint64_t hash(const Entry &key)
+        {
+            const uint64_t edge = (static_cast<uint64_t>(key.parent) << 32) | key.row_idx;
+            return math::splitmix64(edge ^ math::splitmix64(key.col_idx ^ math::splitmix64(key.obs_hash)));
+        }
+
+        void grow()
+        {
+            std::vector<Entry> old_entries(2 * entries.size());
+            std::swap(old_entries, entries);
+            mask = entries.size() - 1;
+            for (const Entry &entry : old_entries)
+            {
+                if (entry.index == 0)
+                {
+                    continue;
+                }
+                size_t slot = hash(entry) & mask;
+                while (entries[slot].index != 0)
+                {
+                    slot = (slot + 1) & mask;
+                }
+                entries[slot] = entry;
+            }
+        }
+    };
+
     class Search : public Types::BanditAlgorithm
     {
     public:
@@ -42,18 +184,14 @@ struct TreeBanditFlat : Types
 
         Search(const Types::BanditAlgorithm &base) : Types::BanditAlgorithm{base} {}
 
-        std::array<MatrixData, Options::max_iterations> matrix_data{};
-
-        // reset every run call
-        size_t iteration = 0;
+        // index 0 is the root
+        std::vector<MatrixData> matrix_data{};
 
-        bool info[2 * Options::max_iterations];
-
-        std::unordered_map<uint64_t, int> transition{};
+        TransitionTable transition{Options::max_iterations};
 
         // reset every iteration
         int depth = 0;
-        int index = 0;
+        uint32_t index = 0;
         typename Types::ModelOutput leaf_output;
         int rows, cols;
 
@@ -61,7 +199,43 @@ struct TreeBanditFlat : Types
 
         std::array<typename Types::Outcome, Options::max_depth> outcomes{};
 
-        std::array<int, Options::max_depth> matrix_indices{};
+        std::array<uint32_t, Options::max_depth + 1> matrix_indices{};
+
+        friend std::ostream &operator<<(std::ostream &os, const Search &search)
+        {
+            os << "TreeBanditFlat - ";
+            os << static_cast<typename Types::BanditAlgorithm>(search);
+            return os;
+        }
+
+        // discard the tree
+        void clear()
+        {
+            matrix_data.clear();
+            transition.reset(Options::max_iterations);
+        }
+
+        size_t run(
+            const size_t duration_ms,
+            Types::PRNG &device,
+            const Types::State &state,
+            Types::Model &model)
+        {
+            init();
+            auto start = std::chrono::high_resolution_clock::now();
+            auto end = std::chrono::high_resolution_clock::now();
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            size_t iterations = 0;
+            for (; duration.count() < duration_ms; ++iterations)
+            {
+                typename Types::State state_copy = state;
+                state_copy.randomize_transition(device);
+                run_iteration(device, state_copy, model);
+                end = std::chrono::high_resolution_clock::now();
+                duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+            }
+            return iterations;
+        }
 
         size_t run_for_iterations(
             const size_t iterations,
@@ -69,10 +243,9 @@ struct TreeBanditFlat : Types
             const Types::State &state,
             Types::Model &model)
         {
-            transition = std::unordered_map<uint64_t, int>{};
-            memset(info, false, 2 * Options::max_iterations * sizeof(bool));
+            init();
             const auto start = std::chrono::high_resolution_clock::now();
-            for (iteration = 0; iteration < iterations; ++iteration)
+            for (size_t iteration = 0; iteration < iterations; ++iteration)
             {
                 typename Types::State state_copy = state;
                 state_copy.randomize_transition(device);
@@ -90,41 +263,40 @@ struct TreeBanditFlat : Types
         {
             depth = 0;
             index = 0;
+            matrix_indices[0] = 0;
 
-            // side by side: was_seen and is_expanded (state, e.g. expanded vectors)
-            bool *info_ptr = &info[2 * index];
+            // invalidated whenever a node is added, so it is always reassigned from the index
+            MatrixData *data = &matrix_data[0];
 
-            while (*info_ptr && !state.is_terminal() && depth < Options::max_depth)
+            while (data->seen && !state.is_terminal() && depth < Options::max_depth)
             {
                 typename Types::Outcome &outcome = outcomes[depth];
-                typename Types::MatrixStats &stats = matrix_data[index].stats;
-                MatrixData &current_data = matrix_data[index];
 
                 // not really expanded
-                if (!*(info_ptr + 1))
+                if (!data->expanded)
                 {
                     if constexpr (!std::is_same_v<typename Options::NodeActions, void>)
                     {
-                        state.get_actions(matrix_data[index].row_actions, current_data.col_actions);
-                        rows = current_data.row_actions.size();
-                        cols = current_data.col_actions.size();
+                        state.get_actions(data->row_actions, data->col_actions);
+                        rows = data->row_actions.size();
+                        cols = data->col_actions.size();
                     }
                     else
                     {
                         rows = state.row_actions.size();
                         cols = state.col_actions.size();
                     }
-                    this->expand_state_part(stats, rows, cols);
-                    *(info_ptr + 1) = true;
+                    this->expand_state_part(data->stats, rows, cols);
+                    data->expanded = true;
                 }
 
-                this->select(device, stats, outcome);
+                this->select(device, data->stats, outcome);
 
                 if constexpr (!std::is_same_v<typename Options::NodeActions, void>)
                 {
                     state.apply_actions(
-                        current_data.row_actions[outcome.row_idx],
-                        current_data.col_actions[outcome.col_idx]);
+                        data->row_actions[outcome.row_idx],
+                        data->col_actions[outcome.col_idx]);
                 }
                 else
                 {
@@ -135,13 +307,17 @@ struct TreeBanditFlat : Types
                 }
 
                 ++depth;
-                uint64_t hash_ = hash(index, outcome.row_idx, outcome.col_idx, hash_function(state.get_obs()));
+                uint32_t &child_index = transition(
+                    index, outcome.row_idx, outcome.col_idx,
+                    static_cast<uint64_t>(hash_function(state.get_obs())));
 
-                if (transition[hash_] == 0)
+                if (child_index == 0)
                 {
-                    index = iteration;
-                    transition[hash_] = iteration;
-                    info_ptr = &info[2 * index];
+                    child_index = matrix_data.size();
+                    matrix_data.emplace_back();
+                    index = child_index;
+                    matrix_indices[depth] = index;
+                    data = &matrix_data[index];
                     if constexpr (std::is_same_v<typename Options::return_after_expand, void>)
                     {
                         break;
@@ -149,10 +325,10 @@ struct TreeBanditFlat : Types
                 }
                 else
                 {
-                    index = transition[hash_];
-                    info_ptr = &info[2 * index];
+                    index = child_index;
+                    matrix_indices[depth] = index;
+                    data = &matrix_data[index];
                 }
-                matrix_indices[depth] = index;
             }
 
             if (state.is_terminal())
@@ -161,17 +337,17 @@ struct TreeBanditFlat : Types
             }
             else
             {
-                *info_ptr = true;
+                data->seen = true;
                 model.inference(std::move(state), leaf_output);
             }
 
-            this->expand_inference_part(matrix_data[index].stats, leaf_output);
+            this->expand_inference_part(data->stats, leaf_output);
             if constexpr (!std::is_same_v<typename Options::NodeValue, void>)
             {
-                matrix_data[index].value = leaf_output.value;
+                data->value = leaf_output.value;
             }
 
-            for (int d = 0; d < depth; ++d)
+            for (int d = depth - 1; d >= 0; --d)
             {
                 if constexpr (std::is_same_v<typename Options::update_using_average, void>)
                 {
@@ -179,7 +355,6 @@ struct TreeBanditFlat : Types
                 }
                 else
                 {
-                    // TODO fix!! check d + 1
                     this->get_empirical_value(matrix_data[matrix_indices[d + 1]].stats, outcomes[d].value);
                 }
 
@@ -187,19 +362,14 @@ struct TreeBanditFlat : Types
             }
         }
 
-        inline uint64_t hash(
-            const int index,
-            const int row_idx,
-            const int col_idx,
-            const uint64_t obs_hash) const
+    private:
+        void init()
         {
-            size_t h = 17;
-            h = h * 31 + index;
-            h = h * 31 + row_idx;
-            h = h * 31 + col_idx;
-            h = h * 31 + static_cast<uint64_t>(obs_hash);
-            h = h * 31 + static_cast<uint64_t>(obs_hash >> 32);
-            return h;
+            if (matrix_data.empty())
+            {
+                matrix_data.reserve(Options::max_iterations);
+                matrix_data.emplace_back();
+            }
         }
     };
 };
@@ -6,6 +6,7 @@
 #include <tree/tree.hh>
 
 #include <chrono>
+#include <numeric>
 
 template <
     IsBanditAlgorithmTypes Types,
@@ -15,8 +16,26 @@ template <
 // will auto complete all all this + ::MatrixNode but not the alias decl :(
 struct TreeBandit : Types
 {
-    using MatrixNode = NodePair<Types, typename Types::MatrixStats, typename Types::ChanceStats, typename Options::NodeActions>::MatrixNode;
-    using ChanceNode = NodePair<Types, typename Types::MatrixStats, typename Types::ChanceStats, typename Options::NodeActions>::ChanceNode;
+    // progressive widening: bandit action indices are positions in `row_order` and `col_order`,
+    // which sort the state's actions by prior if the model has a policy that covers them.
+    // an empty order means bandit indices are the state's action indices.
+    // the bandit stats are grown by calling `expand` again, so the bandit's `expand` must keep its stats by (row, col)
+    struct WideningStats : Types::MatrixStats
+    {
+        std::vector<int> row_order, col_order;
+        // the sorted priors, passed to `expand` as the policy. freed once every action is active
+        typename Types::VectorReal sorted_row_priors, sorted_col_priors;
+        size_t rows = 0, cols = 0;
+        size_t active_rows = 0, active_cols = 0;
+        size_t widening_visits = 0;
+    };
+    using MatrixStats = std::conditional_t<
+        std::is_same_v<typename Options::Widening, void>,
+        typename Types::MatrixStats,
+        WideningStats>;
+
+    using MatrixNode = NodePair<Types, MatrixStats, typename Types::ChanceStats, typename Options::NodeActions, typename Options::NodeValue>::MatrixNode;
+    using ChanceNode = NodePair<Types, MatrixStats, typename Types::ChanceStats, typename Options::NodeActions, typename Options::NodeValue>::ChanceNode;
     class Search : public Types::BanditAlgorithm
     {
     public:
@@ -55,6 +74,37 @@ struct TreeBandit : Types
             return iterations;
         }
 
+        // empirical strategies indexed by the state's actions, rather than bandit action indices.
+        // these only differ when using progressive widening, in which case inactive actions get 0
+        void get_action_strategies(
+            MatrixStats &stats,
+            Types::VectorReal &row_strategy,
+            Types::VectorReal &col_strategy) const
+        {
+            if constexpr (!std::is_same_v<typename Options::Widening, void>)
+            {
+                typename Types::VectorReal row_active, col_active;
+                this->get_empirical_strategies(stats, row_active, col_active);
+                const typename Types::Real zero{Rational<>{0}};
+                row_strategy.resize(stats.rows);
+                col_strategy.resize(stats.cols);
+                std::fill(row_strategy.begin(), row_strategy.end(), zero);
+                std::fill(col_strategy.begin(), col_strategy.end(), zero);
+                for (size_t i = 0; i < stats.active_rows; ++i)
+                {
+                    row_strategy[get_action_index(stats.row_order, i)] = row_active[i];
+                }
+                for (size_t j = 0; j < stats.active_cols; ++j)
+                {
+                    col_strategy[get_action_index(stats.col_order, j)] = col_active[j];
+                }
+            }
+            else
+            {
+                this->get_empirical_strategies(stats, row_strategy, col_strategy);
+            }
+        }
+
         size_t run_for_iterations(
             const size_t iterations,
             Types::PRNG &device,
@@ -93,22 +143,27 @@ struct TreeBandit : Types
             {
                 if (!matrix_node->is_expanded())
                 {
+                    size_t rows, cols;
                     if constexpr (!std::is_same_v<typename Options::NodeActions, void>)
                     {
                         state.get_actions(
                             matrix_node->row_actions,
                             matrix_node->col_actions);
-                        const size_t rows = matrix_node->row_actions.size();
-                        const size_t cols = matrix_node->col_actions.size();
-                        model.inference(std::move(state), model_output);
-                        matrix_node->expand(rows, cols);
-                        this->expand(matrix_node->stats, rows, cols, model_output);
+                        rows = matrix_node->row_actions.size();
+                        cols = matrix_node->col_actions.size();
+                    }
+                    else
+                    {
+                        rows = state.row_actions.size();
+                        cols = state.col_actions.size();
+                    }
+                    model.inference(std::move(state), model_output);
+                    if constexpr (!std::is_same_v<typename Options::Widening, void>)
+                    {
+                        expand_widened(matrix_node, rows, cols, model_output);
                     }
                     else
                     {
-                        const size_t rows = state.row_actions.size();
-                        const size_t cols = state.col_actions.size();
-                        model.inference(std::move(state), model_output);
                         matrix_node->expand(rows, cols);
                         this->expand(matrix_node->stats, rows, cols, model_output);
                     }
@@ -125,21 +180,34 @@ struct TreeBandit : Types
                 else
                 {
                     typename Types::Outcome outcome;
-                    this->select(device, matrix_node->stats, outcome);
+                    int row_action_idx, col_action_idx;
+                    if constexpr (!std::is_same_v<typename Options::Widening, void>)
+                    {
+                        widen(matrix_node);
+                        this->select(device, matrix_node->stats, outcome);
+                        row_action_idx = get_action_index(matrix_node->stats.row_order, outcome.row_idx);
+                        col_action_idx = get_action_index(matrix_node->stats.col_order, outcome.col_idx);
+                    }
+                    else
+                    {
+                        this->select(device, matrix_node->stats, outcome);
+                        row_action_idx = outcome.row_idx;
+                        col_action_idx = outcome.col_idx;
+                    }
 
                     ChanceNode *chance_node = matrix_node->access(outcome.row_idx, outcome.col_idx);
 
                     if constexpr (!std::is_same_v<typename Options::NodeActions, void>)
                     {
                         state.apply_actions(
-                            matrix_node->row_actions[outcome.row_idx],
-                            matrix_node->col_actions[outcome.col_idx]);
+                            matrix_node->row_actions[row_action_idx],
+                            matrix_node->col_actions[col_action_idx]);
                     }
                     else
                     {
                         state.apply_actions(
-                            state.row_actions[outcome.row_idx],
-                            state.col_actions[outcome.col_idx]);
+                            state.row_actions[row_action_idx],
+                            state.col_actions[col_action_idx]);
                         state.get_actions();
                     }
 
@@ -162,5 +230,94 @@ struct TreeBandit : Types
                 }
             }
         }
+
+        void expand_widened(
+            MatrixNode *matrix_node,
+            const size_t rows,
+            const size_t cols,
+            const Types::ModelOutput &model_output) const
+        {
+            WideningStats &stats = matrix_node->stats;
+            stats.rows = rows;
+            stats.cols = cols;
+            stats.active_rows = Options::Widening::get_active_actions(0, rows);
+            stats.active_cols = Options::Widening::get_active_actions(0, cols);
+            matrix_node->expand(stats.active_rows, stats.active_cols);
+            if constexpr (IsPolicyModelTypes<Types>)
+            {
+                sort_by_prior(model_output.row_policy, rows, stats.row_order, stats.sorted_row_priors);
+                sort_by_prior(model_output.col_policy, cols, stats.col_order, stats.sorted_col_priors);
+                typename Types::ModelOutput output{model_output};
+                output.row_policy = stats.sorted_row_priors;
+                output.col_policy = stats.sorted_col_priors;
+                this->expand(stats, stats.active_rows, stats.active_cols, output);
+                release_priors(stats);
+            }
+            else
+            {
+                this->expand(stats, stats.active_rows, stats.active_cols, model_output);
+            }
+        }
+
+        void widen(MatrixNode *matrix_node) const
+        {
+            WideningStats &stats = matrix_node->stats;
+            ++stats.widening_visits;
+            const size_t rows = Options::Widening::get_active_actions(stats.widening_visits, stats.rows);
+            const size_t cols = Options::Widening::get_active_actions(stats.widening_visits, stats.cols);
+            if (rows > stats.active_rows || cols > stats.active_cols)
+            {
+                stats.active_rows = rows;
+                stats.active_cols = cols;
+                matrix_node->expand(rows, cols);
+                typename Types::ModelOutput output{};
+                if constexpr (IsPolicyModelTypes<Types>)
+                {
+                    output.row_policy = stats.sorted_row_priors;
+                    output.col_policy = stats.sorted_col_priors;
+                }
+                this->expand(stats, rows, cols, output);
+                release_priors(stats);
+            }
+        }
+
+        static int get_action_index(const std::vector<int> &order, const int index)
+        {
+            return order.empty() ? index : order[index];
+        }
+
+        // a policy that does not cover every action is ignored, and the actions are widened in their own order
+        static void sort_by_prior(
+            const Types::VectorReal &policy,
+            const size_t actions,
+            std::vector<int> &order,
+            Types::VectorReal &priors)
+        {
+            if (policy.size() < actions)
+            {
+                return;
+            }
+            order.resize(actions);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(
+                order.begin(), order.end(),
+                [&policy](const int a, const int b)
+                { return policy[a] > policy[b]; });
+            priors.resize(actions);
+            for (size_t i = 0; i < actions; ++i)
+            {
+                priors[i] = policy[order[i]];
+            }
+        }
+
+        // the priors are only passed to `expand`, which is not called again once every action is active
+        static void release_priors(WideningStats &stats)
+        {
+            if (stats.active_rows == stats.rows && stats.active_cols == stats.cols)
+            {
+                stats.sorted_row_priors = typename Types::VectorReal{};
+                stats.sorted_col_priors = typename Types::VectorReal{};
+            }
+        }
     };
 };
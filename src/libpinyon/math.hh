@@ -99,4 +99,6 @@ Real exploitability(const Matrix<Value> &value_matrix, const Vector<Real> &row_s
     return Real{row_best_response - row_payoff + col_best_response - col_payoff};
 }
 
+// splitmix64 is in types/random.hh, since philox derives its key with it
+
 }  // namespace math
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+
+Fixed set of worker threads for data parallel loops.
+
+`parallel_for(n, f)` calls f(i) for every i in [0, n) and returns when all calls are done.
+The calling thread also takes indices, so a pool of `threads` spawns `threads - 1` workers
+and a pool of 1 thread runs everything inline. Indices are claimed dynamically, so f must not
+depend on which thread runs it; anything random should be seeded per index beforehand.
+
+Only one `parallel_for` runs on the workers at a time. A call made while another thread's call is running
+does not wait for it, it runs all of its indices on the calling thread instead. So models that share a pool
+can still be called from several search threads at once.
+
+*/
+
+class ThreadPool
+{
+public:
+    const size_t threads;
+
+    ThreadPool(const size_t threads) : threads{threads > 0 ? threads : 1}
+    {
+        workers.reserve(this->threads - 1);
+        for (size_t i = 1; i < this->threads; ++i)
+        {
+            workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock lock{mutex};
+            stop = true;
+        }
+        start_cv.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    template <typename F>
+    void parallel_for(const size_t n, F &&f)
+    {
+        std::unique_lock run_lock{run_mutex, std::try_to_lock};
+        if (workers.empty() || n <= 1 || !run_lock.owns_lock())
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                f(i);
+            }
+            return;
+        }
+        {
+            std::unique_lock lock{mutex};
+            job = std::ref(f);
+            size = n;
+            next.store(0, std::memory_order_relaxed);
+            active = workers.size();
+            ++generation;
+        }
+        start_cv.notify_all();
+        run_job();
+        std::unique_lock lock{mutex};
+        done_cv.wait(lock, [this]() { return active == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    // held by the thread whose parallel_for is running on the workers
+    std::mutex run_mutex;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+
+    // guarded by mutex
+    std::function<void(size_t)> job;
+    size_t size = 0;
+    size_t generation = 0;
+    size_t active = 0;
+    bool stop = false;
+
+    std::atomic<size_t> next{0};
+
+    void run_job()
+    {
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < size;
+             i = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            job(i);
+        }
+    }
+
+    void work()
+    {
+        size_t seen = 0;
+        while (true)
+        {
+            {
+                std::unique_lock lock{mutex};
+                start_cv.wait(lock, [this, seen]() { return stop || generation != seen; });
+                if (stop)
+                {
+                    return;
+                }
+                seen = generation;
+            }
+            run_job();
+            std::unique_lock lock{mutex};
+            if (--active == 0)
+            {
+                done_cv.notify_one();
+            }
+        }
+    }
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <model/model.hh>
+#include <state/state.hh>
+
+#include <atomic>
+#include <memory>
+
+/*
+
+Any model with an evaluation cache in front of it, keyed on `State::get_hash()`.
+
+The cache is a fixed size set-associative table with `ways` entries per set.
+Copies of the model share the cache, so e.g. the threads of TreeBanditThreaded all read and write the same table.
+No thread ever waits: each entry has a spinlock that is only ever `try_lock`ed,
+and a lookup or store that finds its entry busy is simply counted as a miss or dropped.
+
+Hits return the stored output as-is, so stochastic models like MonteCarloModel become deterministic per state.
+
+*/
+
+template <IsSingleModelTypes Types, size_t ways = 4>
+    requires IsHashableStateTypes<Types>
+struct CachedModel : Types
+{
+
+    class Cache
+    {
+    public:
+        Cache(const size_t log_sets)
+            : mask{(size_t{1} << log_sets) - 1},
+              entries{std::make_unique<Entry[]>((mask + 1) * ways)}
+        {
+        }
+
+        bool find(const uint64_t hash, Types::ModelOutput &output)
+        {
+            const uint64_t key = get_key(hash);
+            Entry *set = &entries[(key & mask) * ways];
+            for (size_t way = 0; way < ways; ++way)
+            {
+                Entry &entry = set[way];
+                if (entry.key.load(std::memory_order_relaxed) != key)
+                {
+                    continue;
+                }
+                if (entry.lock.try_lock())
+                {
+                    // the entry may have been replaced since the key was read
+                    const bool hit = entry.key.load(std::memory_order_relaxed) == key;
+                    if (hit)
+                    {
+                        output = entry.output;
+                    }
+                    entry.lock.unlock();
+                    if (hit)
+                    {
+                        hits.fetch_add(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                }
+                break;
+            }
+            misses.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        void store(const uint64_t hash, const Types::ModelOutput &output)
+        {
+            const uint64_t key = get_key(hash);
+            Entry *set = &entries[(key & mask) * ways];
+            // the entry with the same key, else an empty entry, else one picked by the high bits of the key
+            size_t victim = (key >> 32) % ways;
+            for (size_t way = ways; way-- > 0;)
+            {
+                const uint64_t entry_key = set[way].key.load(std::memory_order_relaxed);
+                if (entry_key == key)
+                {
+                    victim = way;
+                    break;
+                }
+                if (entry_key == 0)
+                {
+                    victim = way;
+                }
+            }
+            Entry &entry = set[victim];
+            if (entry.lock.try_lock())
+            {
+                entry.output = output;
+                entry.key.store(key, std::memory_order_relaxed);
+                entry.lock.unlock();
+            }
+        }
+
+        size_t get_hits() const
+        {
+            return hits.load(std::memory_order_relaxed);
+        }
+
+        size_t get_misses() const
+        {
+            return misses.load(std::memory_order_relaxed);
+        }
+
+        size_t get_capacity() const
+        {
+            return (mask + 1) * ways;
+        }
+
+    private:
+        struct Entry
+        {
+            // 0 marks an empty entry
+            std::atomic<uint64_t> key{0};
+            spinlock lock;
+            Types::ModelOutput output;
+        };
+
+        static inline uint64_t get_key(const uint64_t hash)
+        {
+            return hash | (hash == 0);
+        }
+
+        const size_t mask;
+        std::unique_ptr<Entry[]> entries;
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+    };
+
+    class Model : public Types::Model
+    {
+    public:
+        std::shared_ptr<Cache> cache;
+
+        Model(
+            const Types::Model &model,
+            const size_t log_sets = 12)
+            : Types::Model{model}, cache{std::make_shared<Cache>(log_sets)}
+        {
+        }
+
+        Model(
+            const Types::Model &model,
+            const std::shared_ptr<Cache> &cache)
+            : Types::Model{model}, cache{cache}
+        {
+        }
+
+        void inference(
+            Types::State &&state,
+            Types::ModelOutput &output)
+        {
+            const uint64_t hash = state.get_hash();
+            if (cache->find(hash, output))
+            {
+                return;
+            }
+            Types::Model::inference(std::move(state), output);
+            cache->store(hash, output);
+        }
+
+        void inference(
+            Types::ModelBatchInput &batch_input,
+            Types::ModelBatchOutput &batch_output)
+        {
+            batch_output.resize(batch_input.size());
+            for (size_t i = 0; i < batch_input.size(); ++i)
+            {
+                inference(std::move(batch_input[i]), batch_output[i]);
+            }
+        }
+
+        size_t get_hits() const
+        {
+            return cache->get_hits();
+        }
+
+        size_t get_misses() const
+        {
+            return cache->get_misses();
+        }
+    };
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <model/model.hh>
+#include <libpinyon/thread-pool.hh>
+
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+
+A weighted average of several models of the same type, e.g. networks with different weights
+or Monte-Carlo models with different seeds and options.
+
+The members are evaluated in parallel on `pool`, one member per task, so the latency of a single inference
+is that of the slowest member rather than the sum. For batched inference each member gets the whole batch
+as one call of its own batched `inference`, if it has one, otherwise it evaluates the states one by one.
+Values, and policies if the model has them, are combined with the normalized `weights`.
+
+Copies of the model copy the members and share the pool. A copy that calls while the pool is busy
+with another copy evaluates its members on its own thread (see ThreadPool).
+
+*/
+
+namespace EnsembleModelDetail
+{
+    // what each member is given in batched inference
+    template <typename Types, bool is_batch>
+    struct MemberBatch
+    {
+        using Input = std::vector<typename Types::State>;
+        using Output = std::vector<typename Types::ModelOutput>;
+    };
+
+    template <typename Types>
+    struct MemberBatch<Types, true>
+    {
+        using Input = Types::ModelBatchInput;
+        using Output = Types::ModelBatchOutput;
+    };
+};
+
+template <IsSingleModelTypes Types>
+struct EnsembleModel : Types
+{
+    using MemberBatch = EnsembleModelDetail::MemberBatch<Types, IsBatchModelTypes<Types>>;
+    using ModelBatchInput = std::vector<typename Types::State>;
+    using ModelBatchOutput = std::vector<typename Types::ModelOutput>;
+
+    class Model
+    {
+    public:
+        std::vector<typename Types::Model> members;
+        // normalized to sum to 1
+        std::vector<double> weights;
+        std::shared_ptr<ThreadPool> pool{};
+
+        // uniform weights if `weights` is empty, and no pool if `threads` is 0.
+        // Throws if there are no members, or the weights do not match them or do not have a positive total
+        Model(
+            const std::vector<typename Types::Model> &members,
+            const std::vector<double> &weights = {},
+            const size_t threads = 0)
+            : members{members},
+              weights{weights.empty() ? std::vector<double>(members.size(), 1) : weights},
+              pool{threads > 0 ? std::make_shared<ThreadPool>(threads) : nullptr}
+        {
+            if (members.empty())
+            {
+                throw std::runtime_error("EnsembleModel: no members");
+            }
+            if (this->weights.size() != members.size())
+            {
+                throw std::runtime_error("EnsembleModel: " + std::to_string(this->weights.size()) +
+                                         " weights for " + std::to_string(members.size()) + " members");
+            }
+            const double total = std::accumulate(this->weights.begin(), this->weights.end(), 0.0);
+            if (!(total > 0))
+            {
+                throw std::runtime_error("EnsembleModel: weights must have a positive total");
+            }
+            for (double &weight : this->weights)
+            {
+                weight /= total;
+            }
+        }
+
+        Model(const Model &other) : members{other.members}, weights{other.weights}, pool{other.pool} {}
+
+        void inference(
+            Types::State &&state,
+            Types::ModelOutput &output)
+        {
+            member_outputs.resize(members.size());
+            for_each_member(
+                [&](const size_t m)
+                {
+                    members[m].inference(typename Types::State{state}, member_outputs[m]);
+                });
+            combine(member_outputs, output);
+        }
+
+        void inference(
+            ModelBatchInput &batch_input,
+            ModelBatchOutput &batch_output)
+        {
+            const size_t size = batch_input.size();
+            batch_output.resize(size);
+            member_batch_outputs.resize(members.size());
+            if constexpr (IsBatchModelTypes<Types>)
+            {
+                member_batch_inputs.resize(members.size());
+                for_each_member(
+                    [&](const size_t m)
+                    {
+                        auto &member_input = member_batch_inputs[m];
+                        auto &member_output = member_batch_outputs[m];
+                        member_input.clear();
+                        for (const auto &state : batch_input)
+                        {
+                            members[m].add_to_batch_input(typename Types::State{state}, member_input);
+                        }
+                        members[m].inference(member_input, member_output);
+                    });
+            }
+            else
+            {
+                for_each_member(
+                    [&](const size_t m)
+                    {
+                        member_batch_outputs[m].resize(size);
+                        for (size_t i = 0; i < size; ++i)
+                        {
+                            members[m].inference(typename Types::State{batch_input[i]}, member_batch_outputs[m][i]);
+                        }
+                    });
+            }
+
+            member_outputs.resize(members.size());
+            for (size_t i = 0; i < size; ++i)
+            {
+                for (size_t m = 0; m < members.size(); ++m)
+                {
+                    if constexpr (IsBatchModelTypes<Types>)
+                    {
+                        members[m].get_output(member_outputs[m], member_batch_outputs[m], i);
+                    }
+                    else
+                    {
+                        member_outputs[m] = member_batch_outputs[m][i];
+                    }
+                }
+                combine(member_outputs, batch_output[i]);
+            }
+        }
+
+        void add_to_batch_input(
+            Types::State &&state,
+            ModelBatchInput &batch_input) const
+        {
+            batch_input.push_back(std::move(state));
+        }
+
+        void get_output(
+            Types::ModelOutput &output,
+            ModelBatchOutput &batch_output,
+            const long int index) const
+        {
+            output = batch_output[index];
+        }
+
+    private:
+        // member scratch, reused between calls
+        std::vector<typename Types::ModelOutput> member_outputs{};
+        std::vector<typename MemberBatch::Input> member_batch_inputs{};
+        std::vector<typename MemberBatch::Output> member_batch_outputs{};
+
+        template <typename F>
+        void for_each_member(F &&f)
+        {
+            if (pool)
+            {
+                pool->parallel_for(members.size(), f);
+            }
+            else
+            {
+                for (size_t m = 0; m < members.size(); ++m)
+                {
+                    f(m);
+                }
+            }
+        }
+
+        void combine(
+            std::vector<typename Types::ModelOutput> &outputs,
+            Types::ModelOutput &output) const
+        {
+            using Real = typename Types::Real;
+            output.value = outputs[0].value * Real{weights[0]};
+            for (size_t m = 1; m < outputs.size(); ++m)
+            {
+                output.value += outputs[m].value * Real{weights[m]};
+            }
+            if constexpr (IsPolicyModelTypes<Types>)
+            {
+                combine_policy(outputs, output.row_policy, &Types::ModelOutput::row_policy);
+                combine_policy(outputs, output.col_policy, &Types::ModelOutput::col_policy);
+            }
+        }
+
+        void combine_policy(
+            const std::vector<typename Types::ModelOutput> &outputs,
+            Types::VectorReal &policy,
+            Types::VectorReal Types::ModelOutput::*member) const
+        {
+            using Real = typename Types::Real;
+            const auto &first = outputs[0].*member;
+            policy.resize(first.size());
+            for (size_t i = 0; i < first.size(); ++i)
+            {
+                policy[i] = Real{first[i] * Real{weights[0]}};
+            }
+            for (size_t m = 1; m < outputs.size(); ++m)
+            {
+                const auto &member_policy = outputs[m].*member;
+                for (size_t i = 0; i < policy.size(); ++i)
+                {
+                    policy[i] = Real{policy[i] + Real{member_policy[i] * Real{weights[m]}}};
+                }
+            }
+        }
+    };
+};
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <model/neural-model.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+
+NeuralModel with the first layer evaluated incrementally, in the style of NNUE.
+
+The state describes itself by a small set of active binary features, `get_active_features(std::vector<uint32_t> &)`,
+see `IsSparseFeatureStateTypes`. The first layer of a binary input is just the sum of the weight columns of the
+active features, so the wrapped `State` carries that sum (the accumulator) and keeps it up to date in `apply_actions`:
+it lists the new active features, diffs them with the previous ones and adds or subtracts only the columns that changed.
+If more features changed than are active, it recomputes the accumulator from the bias instead.
+`refresh()` does that unconditionally, e.g. after modifying the state other than by `apply_actions`.
+
+The model then only runs the layers after the first. The network and file format are NeuralModel's,
+with `inputs` the number of sparse features, `State::n_sparse_features`, which the model checks. Wrapped states are built from a base state and the model's
+`FeatureTransformer`, which holds the first layer transposed so each column is contiguous.
+
+*/
+
+template <typename Types>
+concept IsSparseFeatureStateTypes =
+    requires(
+        const typename Types::State &const_state,
+        std::vector<uint32_t> &features) {
+        {
+            const_state.get_active_features(features)
+        } -> std::same_as<void>;
+        {
+            Types::State::n_sparse_features
+        } -> std::convertible_to<size_t>;
+    } &&
+    IsPerfectInfoStateTypes<Types>;
+
+template <IsSparseFeatureStateTypes Types, bool quantized = false>
+struct IncrementalModel : Types
+{
+    using Network = NeuralModelDetail::Network;
+
+    class FeatureTransformer
+    {
+    public:
+        const std::shared_ptr<const Network> network;
+        // pad(hidden_1)
+        const size_t stride;
+
+        FeatureTransformer(const std::shared_ptr<const Network> &network)
+            : network{network}, stride{NeuralModelDetail::pad(network->hidden_1)}
+        {
+            // every feature index must have a column
+            if (network->inputs != Types::State::n_sparse_features)
+            {
+                throw std::runtime_error("IncrementalModel: network has " + std::to_string(network->inputs) +
+                                         " inputs but the state has " + std::to_string(Types::State::n_sparse_features) + " sparse features");
+            }
+            const NeuralModelDetail::Layer &layer = network->layers[0];
+            columns.assign(layer.inputs * stride, 0);
+            bias.assign(stride, 0);
+            for (size_t o = 0; o < layer.outputs; ++o)
+            {
+                for (size_t i = 0; i < layer.inputs; ++i)
+                {
+                    columns[i * stride + o] = layer.weights[o * NeuralModelDetail::pad(layer.inputs) + i];
+                }
+                bias[o] = layer.bias[o];
+            }
+        }
+
+        void reset(float *accumulator) const
+        {
+            std::copy(bias.begin(), bias.end(), accumulator);
+        }
+
+        void add(float *accumulator, const uint32_t feature) const
+        {
+            const float *column = columns.data() + feature * stride;
+            for (size_t o = 0; o < stride; ++o)
+            {
+                accumulator[o] += column[o];
+            }
+        }
+
+        void subtract(float *accumulator, const uint32_t feature) const
+        {
+            const float *column = columns.data() + feature * stride;
+            for (size_t o = 0; o < stride; ++o)
+            {
+                accumulator[o] -= column[o];
+            }
+        }
+
+    private:
+        // inputs x stride
+        std::vector<float> columns;
+        std::vector<float> bias;
+    };
+
+    class State : public Types::State
+    {
+    public:
+        std::shared_ptr<const FeatureTransformer> transformer;
+        // first layer pre-activations, padded with zeros
+        std::vector<float> accumulator;
+        // sorted
+        std::vector<uint32_t> active;
+
+        State(
+            const Types::State &state,
+            const std::shared_ptr<const FeatureTransformer> &transformer)
+            : Types::State{state}, transformer{transformer}
+        {
+            refresh();
+        }
+
+        void apply_actions(
+            Types::Action row_action,
+            Types::Action col_action)
+        {
+            Types::State::apply_actions(row_action, col_action);
+            update();
+        }
+
+        void apply_actions(
+            Types::Action row_action,
+            Types::Action col_action,
+            Types::Obs chance_action)
+            requires IsChanceStateTypes<Types>
+        {
+            Types::State::apply_actions(row_action, col_action, chance_action);
+            update();
+        }
+
+        void refresh()
+        {
+            this->get_active_features(active);
+            std::sort(active.begin(), active.end());
+            accumulator.resize(transformer->stride);
+            transformer->reset(accumulator.data());
+            for (const uint32_t feature : active)
+            {
+                transformer->add(accumulator.data(), feature);
+            }
+        }
+
+    private:
+        void update()
+        {
+            thread_local std::vector<uint32_t> next{};
+            this->get_active_features(next);
+            std::sort(next.begin(), next.end());
+
+            // both lists are sorted, so the symmetric difference is one merge
+            size_t changes = 0;
+            for (size_t i = 0, j = 0; i < active.size() || j < next.size();)
+            {
+                if (j == next.size() || (i < active.size() && active[i] < next[j]))
+                {
+                    ++changes;
+                    ++i;
+                }
+                else if (i == active.size() || next[j] < active[i])
+                {
+                    ++changes;
+                    ++j;
+                }
+                else
+                {
+                    ++i;
+                    ++j;
+                }
+            }
+            if (changes > next.size())
+            {
+                refresh();
+                return;
+            }
+            for (size_t i = 0, j = 0; i < active.size() || j < next.size();)
+            {
+                if (j == next.size() || (i < active.size() && active[i] < next[j]))
+                {
+                    transformer->subtract(accumulator.data(), active[i++]);
+                }
+                else if (i == active.size() || next[j] < active[i])
+                {
+                    transformer->add(accumulator.data(), next[j++]);
+                }
+                else
+                {
+                    ++i;
+                    ++j;
+                }
+            }
+            active.swap(next);
+        }
+    };
+
+    struct ModelOutput
+    {
+        Types::Value value;
+        Types::VectorReal row_policy, col_policy;
+    };
+
+    // the first layer activations of each entry, contiguous
+    struct ModelBatchInput
+    {
+        std::vector<float> hidden_1;
+        std::vector<int> rows, cols;
+
+        ModelBatchInput() {}
+
+        ModelBatchInput(const size_t capacity)
+        {
+            rows.reserve(capacity);
+            cols.reserve(capacity);
+        }
+
+        size_t size() const
+        {
+            return rows.size();
+        }
+
+        void clear()
+        {
+            hidden_1.clear();
+            rows.clear();
+            cols.clear();
+        }
+    };
+
+    using ModelBatchOutput = std::vector<ModelOutput>;
+
+    class Model
+    {
+    public:
+        std::shared_ptr<const FeatureTransformer> transformer;
+
+        Model(const std::string &path)
+            : transformer{std::make_shared<const FeatureTransformer>(std::make_shared<const Network>(Network::load(path)))}
+        {
+        }
+
+        Model(const std::shared_ptr<const Network> &network)
+            : transformer{std::make_shared<const FeatureTransformer>(network)}
+        {
+        }
+
+        // copies share the transformer but not the scratch space
+        Model(const Model &other) : transformer{other.transformer} {}
+
+        State get_state(const Types::State &state) const
+        {
+            return State{state, transformer};
+        }
+
+        void inference(
+            State &&state,
+            ModelOutput &output)
+        {
+            single_input.clear();
+            add_to_batch_input(std::move(state), single_input);
+            forward(single_input);
+            NeuralModelDetail::write_output<Types>(
+                *transformer->network, scratch, 0, single_input.rows[0], single_input.cols[0], output);
+        }
+
+        void inference(
+            ModelBatchInput &batch_input,
+            ModelBatchOutput &batch_output)
+        {
+            const size_t batch = batch_input.size();
+            batch_output.resize(batch);
+            forward(batch_input);
+            for (size_t b = 0; b < batch; ++b)
+            {
+                NeuralModelDetail::write_output<Types>(
+                    *transformer->network, scratch, b, batch_input.rows[b], batch_input.cols[b], batch_output[b]);
+            }
+        }
+
+        template <typename PackedTypes, typename Q>
+        void inference(
+            ModelBatchInput &batch_input,
+            PackedBatchOutput<PackedTypes, Q> &batch_output)
+        {
+            const size_t batch = batch_input.size();
+            batch_output.clear();
+            forward(batch_input);
+            for (size_t b = 0; b < batch; ++b)
+            {
+                NeuralModelDetail::write_output(
+                    *transformer->network, scratch, b, batch_input.rows[b], batch_input.cols[b], batch_output);
+            }
+        }
+
+        void add_to_batch_input(
+            State &&state,
+            ModelBatchInput &batch_input) const
+        {
+            const size_t start = batch_input.hidden_1.size();
+            batch_input.hidden_1.resize(start + transformer->stride);
+            std::transform(
+                state.accumulator.begin(), state.accumulator.end(), batch_input.hidden_1.begin() + start,
+                [](const float x)
+                { return std::max(x, 0.0f); });
+            batch_input.rows.push_back(state.row_actions.size());
+            batch_input.cols.push_back(state.col_actions.size());
+        }
+
+        void get_output(
+            ModelOutput &output,
+            ModelBatchOutput &batch_output,
+            const long int index) const
+        {
+            output = batch_output[index];
+        }
+
+    private:
+        NeuralModelDetail::Scratch scratch{};
+        ModelBatchInput single_input{1};
+
+        void forward(const ModelBatchInput &batch_input)
+        {
+            const Network &network = *transformer->network;
+            const size_t batch = batch_input.size();
+            scratch.resize(network, batch);
+            std::copy(batch_input.hidden_1.begin(), batch_input.hidden_1.end(), scratch.hidden_1.begin());
+            NeuralModelDetail::forward_from_hidden_1<quantized>(network, batch, scratch);
+        }
+    };
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <model/model.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+
+A batched model served by a dedicated thread, presented to search threads as a single inference model.
+
+Search threads push requests onto a lock-free intrusive stack and sleep on the request until it is done.
+The server thread takes the whole stack at once, and runs a batch when it has `max_batch_size` requests
+or `timeout` has passed since the oldest waiting request arrived (or the last batch finished, if it was left over).
+While a partial batch waits the server thread sleeps until its timeout or the next submit, and when there are no requests
+it sleeps until the next submit.
+The underlying model's batched `inference` is only ever called from the server thread.
+
+Copies of `Model` share the server, so e.g. every thread of TreeBanditThreaded feeds the same batches.
+A thread that has other work can call `submit` itself and poll `Request::is_done` instead of `inference`.
+The server does not touch a request after `is_done` returns true, so the request can then be destroyed.
+
+*/
+
+template <IsBatchModelTypes Types>
+struct InferenceServer : Types
+{
+
+    struct Request
+    {
+        Types::State state;
+        Types::ModelOutput output{};
+        // pending, then done once the output is written, then released once the server has notified the waiter
+        std::atomic<uint8_t> status{pending};
+        Request *next = nullptr;
+
+        static constexpr uint8_t pending = 0;
+        static constexpr uint8_t done = 1;
+        static constexpr uint8_t released = 2;
+
+        Request(Types::State &&state) : state{std::move(state)} {}
+
+        bool is_done() const
+        {
+            return status.load(std::memory_order_acquire) == released;
+        }
+
+        void wait() const
+        {
+            status.wait(pending, std::memory_order_acquire);
+            // the server is between notifying and releasing, which is only a few instructions
+            while (!is_done())
+            {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    class Server
+    {
+    public:
+        const size_t max_batch_size;
+        const std::chrono::microseconds timeout;
+
+        Server(
+            const Types::Model &model,
+            const size_t max_batch_size,
+            const std::chrono::microseconds timeout)
+            : max_batch_size{max_batch_size}, timeout{timeout}, model{model}
+        {
+            thread = std::thread(&Server::run_thread, this);
+        }
+
+        Server(const Server &) = delete;
+
+        ~Server()
+        {
+            stop.store(true, std::memory_order_relaxed);
+            wake();
+            thread.join();
+        }
+
+        void submit(Request &request)
+        {
+            request.next = head.load(std::memory_order_relaxed);
+            while (!head.compare_exchange_weak(request.next, &request, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+            wake();
+        }
+
+        size_t get_batches() const
+        {
+            return batches.load(std::memory_order_relaxed);
+        }
+
+        size_t get_items() const
+        {
+            return items.load(std::memory_order_relaxed);
+        }
+
+    private:
+        Types::Model model;
+        std::atomic<Request *> head{nullptr};
+        // bumped on every submit and on stop, so the server can sleep when it has nothing to do
+        std::atomic<uint32_t> signal{0};
+        // a partial batch waits on `partial` until its timeout. `waiting` is set while it does,
+        // so that submits only lock `mutex` when the server might be sleeping on it
+        std::mutex mutex{};
+        std::condition_variable partial{};
+        std::atomic<bool> waiting{false};
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> batches{0};
+        std::atomic<size_t> items{0};
+        std::thread thread{};
+
+        // `signal` and `waiting` are sequentially consistent, so either the server sees the new signal
+        // before it sleeps on `partial`, or this sees `waiting` and notifies it
+        void wake()
+        {
+            signal.fetch_add(1);
+            signal.notify_one();
+            if (waiting.load())
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                partial.notify_one();
+            }
+        }
+
+        // moves the stack onto the end of `pending`, oldest first
+        void take(std::vector<Request *> &pending)
+        {
+            Request *request = head.exchange(nullptr, std::memory_order_acquire);
+            const size_t start = pending.size();
+            for (; request != nullptr; request = request->next)
+            {
+                pending.push_back(request);
+            }
+            std::reverse(pending.begin() + start, pending.end());
+        }
+
+        void run_thread()
+        {
+            std::vector<Request *> pending{};
+            typename Types::ModelBatchInput batch_input{};
+            typename Types::ModelBatchOutput batch_output{};
+            using Clock = std::chrono::steady_clock;
+            Clock::time_point oldest{};
+
+            while (true)
+            {
+                const uint32_t seen = signal.load(std::memory_order_acquire);
+                const size_t before = pending.size();
+                take(pending);
+                if (before == 0 && !pending.empty())
+                {
+                    oldest = Clock::now();
+                }
+                if (pending.empty())
+                {
+                    if (stop.load(std::memory_order_relaxed))
+                    {
+                        return;
+                    }
+                    signal.wait(seen, std::memory_order_acquire);
+                    continue;
+                }
+                if (pending.size() < max_batch_size && Clock::now() - oldest < timeout &&
+                    !stop.load(std::memory_order_relaxed))
+                {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    waiting.store(true);
+                    partial.wait_until(lock, oldest + timeout, [&]
+                                       { return signal.load() != seen; });
+                    waiting.store(false);
+                    continue;
+                }
+
+                const size_t size = std::min(pending.size(), max_batch_size);
+                batch_input.clear();
+                for (size_t i = 0; i < size; ++i)
+                {
+                    model.add_to_batch_input(std::move(pending[i]->state), batch_input);
+                }
+                model.inference(batch_input, batch_output);
+                for (size_t i = 0; i < size; ++i)
+                {
+                    Request *request = pending[i];
+                    model.get_output(request->output, batch_output, i);
+                    request->status.store(Request::done, std::memory_order_release);
+                    request->status.notify_one();
+                    request->status.store(Request::released, std::memory_order_release);
+                }
+                pending.erase(pending.begin(), pending.begin() + size);
+                oldest = Clock::now();
+                batches.fetch_add(1, std::memory_order_relaxed);
+                items.fetch_add(size, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    class Model
+    {
+    public:
+        std::shared_ptr<Server> server;
+
+        Model(
+            const Types::Model &model,
+            const size_t max_batch_size,
+            const std::chrono::microseconds timeout)
+            : server{std::make_shared<Server>(model, max_batch_size, timeout)}
+        {
+        }
+
+        Model(const std::shared_ptr<Server> &server) : server{server} {}
+
+        void inference(
+            Types::State &&state,
+            Types::ModelOutput &output)
+        {
+            Request request{std::move(state)};
+            server->submit(request);
+            request.wait();
+            output = std::move(request.output);
+        }
+
+        void submit(Request &request)
+        {
+            server->submit(request);
+        }
+    };
+};
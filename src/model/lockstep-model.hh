@@ -0,0 +1,459 @@
+#pragma once
+
+#include <model/monte-carlo-model.hh>
+#include <libpinyon/math.hh>
+#include <state/hash-random-tree.hh>
+#include <state/test-states.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PINYON_LOCKSTEP_X86
+#endif
+
+/*
+
+MonteCarloModel whose batched inference plays all the rollouts of a batch together, one joint action at a time.
+
+The rollouts are held as a structure of arrays, `LockstepModelDetail::Lanes<Types>`, one lane per rollout.
+Each step advances every lane, finished lanes are swapped out with the last lane, so the arrays stay dense
+and the only masking is of the padding at the end. Randomness is counter based: the lane's seed and the step
+number are hashed, so there is no per lane generator state to advance and the hashes of all lanes are one
+vectorised loop (AVX2, chosen at run time).
+
+Lanes exist for MoldState and HashRandomTree. HashRandomTree lanes reproduce the state's own transitions
+exactly, with the hashes vectorised and only the modular reductions done per lane.
+For other state types, e.g. RandomTree whose transitions advance an embedded PRNG and regenerate chance tables,
+the batch falls back to MonteCarloModel's rollouts.
+The `rollouts` and `max_depth` options are supported; single inference is always MonteCarloModel's.
+
+*/
+
+namespace LockstepModelDetail
+{
+    // 64 bit lanes per AVX2 register. Lane arrays are padded to a multiple of this
+    constexpr size_t width = 4;
+
+    inline size_t pad(const size_t n)
+    {
+        return (n + width - 1) & ~(width - 1);
+    }
+
+    constexpr uint64_t golden = 0x9e3779b97f4a7c15;
+
+#ifdef PINYON_LOCKSTEP_X86
+    // low 64 bits of the lane products, from 32 bit multiplies
+    __attribute__((target("avx2"))) inline __m256i mul_64(const __m256i a, const __m256i b)
+    {
+        const __m256i low = _mm256_mul_epu32(a, b);
+        const __m256i cross = _mm256_add_epi64(
+            _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+            _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+        return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+    }
+
+    __attribute__((target("avx2"))) inline void splitmix64_avx2(uint64_t *x, const size_t n)
+    {
+        const __m256i c_0 = _mm256_set1_epi64x(golden);
+        const __m256i c_1 = _mm256_set1_epi64x(0xbf58476d1ce4e5b9);
+        const __m256i c_2 = _mm256_set1_epi64x(0x94d049bb133111eb);
+        for (size_t i = 0; i < n; i += width)
+        {
+            __m256i v = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + i)), c_0);
+            v = mul_64(_mm256_xor_si256(v, _mm256_srli_epi64(v, 30)), c_1);
+            v = mul_64(_mm256_xor_si256(v, _mm256_srli_epi64(v, 27)), c_2);
+            v = _mm256_xor_si256(v, _mm256_srli_epi64(v, 31));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(x + i), v);
+        }
+    }
+
+    inline bool has_avx2()
+    {
+        static const bool result = __builtin_cpu_supports("avx2");
+        return result;
+    }
+#else
+    inline bool has_avx2()
+    {
+        return false;
+    }
+#endif
+
+    // math::splitmix64 of every element, in place. n is a multiple of `width`
+    inline void splitmix64(uint64_t *x, const size_t n)
+    {
+#ifdef PINYON_LOCKSTEP_X86
+        if (has_avx2())
+        {
+            splitmix64_avx2(x, n);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < n; ++i)
+        {
+            x[i] = math::splitmix64(x[i]);
+        }
+    }
+
+    // the random bits of a lane at a step
+    inline uint64_t get_draw(const uint64_t seed, const size_t step)
+    {
+        return math::splitmix64(seed + step * golden);
+    }
+
+    // uniform index below n from 32 random bits, by multiply and shift
+    inline uint64_t get_index(const uint64_t bits, const uint64_t n)
+    {
+        return (bits * n) >> 32;
+    }
+
+    // the joint action and transition seed of a HashRandomTree lane at a step.
+    // The lanes compute the same thing vectorised
+    inline void get_step(
+        const uint64_t seed, const size_t step, const size_t rows, const size_t cols,
+        int &row_idx, int &col_idx, uint64_t &transition_seed)
+    {
+        const uint64_t draw = get_draw(seed, step);
+        row_idx = get_index(draw >> 32, rows);
+        col_idx = get_index(draw & 0xffffffff, cols);
+        transition_seed = math::splitmix64(draw ^ golden);
+    }
+
+    /*
+    A batch of rollouts of one state type. Specializations provide
+
+        void clear();
+        void push(const State &state, uint64_t seed, size_t index);
+        size_t size() const;
+        void step(size_t step);
+        bool is_terminal(size_t lane) const;
+        Value get_value(size_t lane) const; // the payoff, or an estimate if the lane is not terminal
+        size_t get_index(size_t lane) const; // the `index` it was pushed with
+        void remove(size_t lane); // moves the last lane into `lane`
+    */
+    template <typename Types>
+    struct Lanes
+    {
+        static constexpr bool enabled = false;
+    };
+
+    template <typename T>
+    struct Lanes<MoldState<T>>
+    {
+        using Types = MoldState<T>;
+        static constexpr bool enabled = true;
+
+        std::vector<size_t> depth, index;
+        std::vector<typename Types::Value> payoff;
+
+        void clear()
+        {
+            depth.clear();
+            index.clear();
+            payoff.clear();
+        }
+
+        void push(const Types::State &state, const uint64_t, const size_t i)
+        {
+            depth.push_back(state.max_depth);
+            index.push_back(i);
+            payoff.push_back(state.get_payoff());
+        }
+
+        size_t size() const
+        {
+            return depth.size();
+        }
+
+        void step(const size_t)
+        {
+            for (size_t &d : depth)
+            {
+                d -= d > 0;
+            }
+        }
+
+        bool is_terminal(const size_t lane) const
+        {
+            return depth[lane] == 0;
+        }
+
+        Types::Value get_value(const size_t lane) const
+        {
+            return is_terminal(lane) ? payoff[lane] : make_draw<Types>();
+        }
+
+        size_t get_index(const size_t lane) const
+        {
+            return index[lane];
+        }
+
+        void remove(const size_t lane)
+        {
+            depth[lane] = depth.back();
+            index[lane] = index.back();
+            payoff[lane] = payoff.back();
+            depth.pop_back();
+            index.pop_back();
+            payoff.pop_back();
+        }
+    };
+
+    template <typename T>
+    struct Lanes<HashRandomTree<T>>
+    {
+        using Types = HashRandomTree<T>;
+        static constexpr bool enabled = true;
+
+        std::vector<uint64_t> path, seed, rows, cols, transitions;
+        std::vector<size_t> depth, index;
+        std::vector<int> payoff_bias, threshold_p, threshold_q, denominator;
+
+        void clear()
+        {
+            for (auto *v : {&path, &seed, &rows, &cols, &transitions})
+            {
+                v->clear();
+            }
+            depth.clear();
+            index.clear();
+            for (auto *v : {&payoff_bias, &threshold_p, &threshold_q, &denominator})
+            {
+                v->clear();
+            }
+        }
+
+        void push(const Types::State &state, const uint64_t lane_seed, const size_t i)
+        {
+            path.push_back(state.path);
+            seed.push_back(lane_seed);
+            rows.push_back(state.rows);
+            cols.push_back(state.cols);
+            transitions.push_back(state.transitions);
+            depth.push_back(state.is_terminal() ? 0 : state.depth_bound);
+            index.push_back(i);
+            payoff_bias.push_back(state.payoff_bias);
+            threshold_p.push_back(state.chance_threshold.p);
+            threshold_q.push_back(state.chance_threshold.q);
+            denominator.push_back(state.chance_denominator);
+        }
+
+        size_t size() const
+        {
+            return path.size();
+        }
+
+        // HashRandomTree::State::apply_actions(row, col) on every lane, with the actions and seed from `get_step`
+        void step(const size_t t)
+        {
+            const size_t n = size();
+            const size_t n_pad = pad(n);
+            draw.assign(n_pad, 0);
+            key.assign(n_pad, 0);
+            transition_seed.assign(n_pad, 0);
+            hash.assign(n_pad, 0);
+            sum.assign(n_pad, 0);
+            size_t max_transitions = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                draw[i] = seed[i] + t * golden;
+                max_transitions = std::max<size_t>(max_transitions, transitions[i]);
+            }
+            weights.assign(max_transitions * n_pad, 0);
+
+            splitmix64(draw.data(), n_pad);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const uint64_t row_idx = LockstepModelDetail::get_index(draw[i] >> 32, rows[i]);
+                const uint64_t col_idx = LockstepModelDetail::get_index(draw[i] & 0xffffffff, cols[i]);
+                key[i] = (row_idx << 32) | col_idx;
+                transition_seed[i] = draw[i] ^ golden;
+            }
+            splitmix64(transition_seed.data(), n_pad);
+            // key = mix(path, joint action)
+            splitmix64(key.data(), n_pad);
+            for (size_t i = 0; i < n; ++i)
+            {
+                key[i] ^= path[i];
+            }
+            splitmix64(key.data(), n_pad);
+
+            // chance weights, mix(key, chance_idx) % denominator + 1 when above the threshold
+            for (size_t c = 0; c < max_transitions; ++c)
+            {
+                const uint64_t c_hash = math::splitmix64(c);
+                for (size_t i = 0; i < n_pad; ++i)
+                {
+                    hash[i] = key[i] ^ c_hash;
+                }
+                splitmix64(hash.data(), n_pad);
+                int *w = weights.data() + c * n_pad;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    const int num = hash[i] % denominator[i] + 1;
+                    w[i] = (c < transitions[i]) * num * (num * threshold_q[i] >= threshold_p[i] * denominator[i]);
+                    sum[i] += w[i];
+                }
+            }
+
+            // sample the chance action, then path = mix(key, transitions + chance_idx)
+            for (size_t i = 0; i < n_pad; ++i)
+            {
+                hash[i] = transition_seed[i] ^ key[i];
+            }
+            splitmix64(hash.data(), n_pad);
+            for (size_t i = 0; i < n; ++i)
+            {
+                size_t chance_idx = 0;
+                if (sum[i] > 0)
+                {
+                    int p = hash[i] % sum[i];
+                    while (p >= weights[chance_idx * n_pad + i])
+                    {
+                        p -= weights[chance_idx++ * n_pad + i];
+                    }
+                }
+                hash[i] = transitions[i] + chance_idx;
+            }
+            splitmix64(hash.data(), n_pad);
+            for (size_t i = 0; i < n; ++i)
+            {
+                hash[i] ^= key[i];
+            }
+            splitmix64(hash.data(), n_pad);
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                path[i] = hash[i];
+                depth[i] -= depth[i] > 0;
+                payoff_bias[i] += static_cast<int>(path[i] % 3) - 1;
+            }
+        }
+
+        bool is_terminal(const size_t lane) const
+        {
+            return depth[lane] == 0;
+        }
+
+        // the heuristic value of HashRandomTree is the payoff it would have if it were terminal
+        Types::Value get_value(const size_t lane) const
+        {
+            return Types::State::get_payoff_from_bias(payoff_bias[lane]);
+        }
+
+        size_t get_index(const size_t lane) const
+        {
+            return index[lane];
+        }
+
+        void remove(const size_t lane)
+        {
+            for (auto *v : {&path, &seed, &rows, &cols, &transitions})
+            {
+                (*v)[lane] = v->back();
+                v->pop_back();
+            }
+            for (auto *v : {&depth, &index})
+            {
+                (*v)[lane] = v->back();
+                v->pop_back();
+            }
+            for (auto *v : {&payoff_bias, &threshold_p, &threshold_q, &denominator})
+            {
+                (*v)[lane] = v->back();
+                v->pop_back();
+            }
+        }
+
+    private:
+        // scratch, padded
+        std::vector<uint64_t> draw, key, transition_seed, hash;
+        std::vector<int> sum, weights;
+    };
+};
+
+template <IsPerfectInfoStateTypes Types, bool has_policy = false>
+struct LockstepModel : MonteCarloModel<Types, has_policy>
+{
+    using Lanes = LockstepModelDetail::Lanes<Types>;
+    using ModelOutput = MonteCarloModel<Types, has_policy>::ModelOutput;
+    using ModelBatchInput = MonteCarloModel<Types, has_policy>::ModelBatchInput;
+    using ModelBatchOutput = MonteCarloModel<Types, has_policy>::ModelBatchOutput;
+
+    class Model : public MonteCarloModel<Types, has_policy>::Model
+    {
+    public:
+        using Base = MonteCarloModel<Types, has_policy>::Model;
+        using Base::Base;
+        using Base::inference;
+
+        // copies don't copy the lanes, which are only scratch space
+        Model(const Model &other) : Base{other} {}
+
+        void inference(
+            ModelBatchInput &batch_input,
+            ModelBatchOutput &batch_output)
+        {
+            if constexpr (!Lanes::enabled)
+            {
+                Base::inference(batch_input, batch_output);
+            }
+            else
+            {
+                const size_t size = batch_input.size();
+                const size_t rollouts = std::max(this->options.rollouts, size_t{1});
+                batch_output.resize(size);
+                totals.assign(size, typename Types::Value{});
+                lanes.clear();
+                for (size_t i = 0; i < size; ++i)
+                {
+                    Base::set_policy(batch_input[i], batch_output[i]);
+                    for (size_t r = 0; r < rollouts; ++r)
+                    {
+                        lanes.push(batch_input[i], this->device.uniform_64(), i);
+                    }
+                }
+
+                for (size_t step = 0; lanes.size() > 0; ++step)
+                {
+                    const bool cut_off = this->options.max_depth > 0 && step >= this->options.max_depth;
+                    for (size_t lane = 0; lane < lanes.size();)
+                    {
+                        if (cut_off || lanes.is_terminal(lane))
+                        {
+                            totals[lanes.get_index(lane)] += lanes.get_value(lane);
+                            lanes.remove(lane);
+                        }
+                        else
+                        {
+                            ++lane;
+                        }
+                    }
+                    if (lanes.size() > 0)
+                    {
+                        lanes.step(step);
+                    }
+                }
+
+                for (size_t i = 0; i < size; ++i)
+                {
+                    if (rollouts == 1)
+                    {
+                        batch_output[i].value = totals[i];
+                    }
+                    else
+                    {
+                        batch_output[i].value = totals[i] * typename Types::Real{Rational<>{1, static_cast<int>(rollouts)}};
+                    }
+                }
+            }
+        }
+
+    private:
+        Lanes lanes{};
+        std::vector<typename Types::Value> totals{};
+    };
+};
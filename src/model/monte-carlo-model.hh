@@ -2,6 +2,11 @@
 
 #include <state/state.hh>
 #include <model/model.hh>
+#include <libpinyon/thread-pool.hh>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace MonteCarloModelDetail
 {
@@ -20,49 +25,129 @@ namespace MonteCarloModelDetail
         Types::Value value;
         Types::VectorReal row_policy, col_policy;
     };
+
+    struct Options
+    {
+        // playouts per inference, averaged
+        size_t rollouts = 1;
+        // joint actions per playout before falling back to the state's heuristic value, 0 for no limit
+        size_t max_depth = 0;
+        // advance the playouts of one inference together a step at a time, rather than one after another
+        bool interleave = false;
+    };
+
+    // the default rollout policy. A policy fills in the indices of the actions to play
+    struct UniformRolloutPolicy
+    {
+        template <typename PRNG, typename State>
+        void sample(PRNG &device, const State &state, int &row_idx, int &col_idx) const
+        {
+            row_idx = device.random_int(state.row_actions.size());
+            col_idx = device.random_int(state.col_actions.size());
+        }
+    };
 };
 
-template <IsPerfectInfoStateTypes Types, bool has_policy = false>
+template <
+    IsPerfectInfoStateTypes Types,
+    bool has_policy = false,
+    typename RolloutPolicy = MonteCarloModelDetail::UniformRolloutPolicy>
 struct MonteCarloModel : Types
 {
 
     using ModelOutput = MonteCarloModelDetail::ModelOutputImpl<Types, has_policy>;
+    using Options = MonteCarloModelDetail::Options;
 
     using ModelBatchInput = std::vector<typename Types::State>;
     using ModelBatchOutput = std::vector<ModelOutput>;
 
+    /*
+    Batched inference seeds a device for each entry from `device` and then rolls the entries out in parallel
+    on `pool`, if there is one. The output only depends on the seed, not on the number of threads.
+    Copies of the model share the pool.
+
+    Each playout is `options.rollouts` playouts averaged. A playout longer than `options.max_depth` is cut off
+    and scored by `get_heuristic_value()` if the state has one (see `IsHeuristicStateTypes`), otherwise as a draw.
+    The `policy` is a const member so it can be shared between threads; any cache it samples from must be thread safe.
+    Interleaved playouts are advanced in scratch buffers owned by the model (one per pool thread for batches),
+    so they stop allocating once the buffers are large enough.
+    */
     class Model
     {
     public:
         Types::PRNG device;
+        std::shared_ptr<ThreadPool> pool{};
+        Options options{};
+        RolloutPolicy policy{};
 
         Model(const Types::PRNG &device) : device{device} {}
 
+        // copies don't copy the scratch buffers
+        Model(const Model &other)
+            : device{other.device}, pool{other.pool}, options{other.options}, policy{other.policy} {}
+
+        Model(const Types::PRNG &device, const size_t threads)
+            : device{device}, pool{std::make_shared<ThreadPool>(threads)} {}
+
+        Model(
+            const Types::PRNG &device,
+            const Options &options,
+            const RolloutPolicy &policy = {},
+            const size_t threads = 0)
+            : device{device},
+              pool{threads > 0 ? std::make_shared<ThreadPool>(threads) : nullptr},
+              options{options},
+              policy{policy}
+        {
+        }
+
         void inference(
             Types::State &&state,
             ModelOutput &output)
         {
-            if constexpr (has_policy)
-            {
-                const size_t rows = state.row_actions.size();
-                const size_t cols = state.col_actions.size();
-                const typename Types::Real row_uniform{Rational{1, static_cast<int>(rows)}};
-                output.row_policy.resize(rows, row_uniform);
-                const typename Types::Real col_uniform{Rational{1, static_cast<int>(cols)}};
-                output.col_policy.resize(cols, col_uniform);
-            }
-            rollout(state);
-            output.value = state.get_payoff();
+            inference(device, std::move(state), output, scratch);
         }
 
         void inference(
             ModelBatchInput &batch_input,
             ModelBatchOutput &batch_output)
         {
-            batch_output.resize(batch_input.size());
-            for (int i = 0; i < batch_input.size(); ++i)
+            const size_t size = batch_input.size();
+            batch_output.resize(size);
+            std::vector<typename Types::Seed> seeds(size);
+            for (auto &seed : seeds)
+            {
+                seed = device.uniform_64();
+            }
+            auto infer = [&](const size_t i, Scratch &scratch)
+            {
+                typename Types::PRNG entry_device{seeds[i]};
+                inference(entry_device, std::move(batch_input[i]), batch_output[i], scratch);
+            };
+            if (pool)
             {
-                inference(std::move(batch_input[i]), batch_output[i]);
+                // strided so that each task has its own scratch
+                const size_t tasks = std::min(pool->threads, size);
+                if (batch_scratch.size() < tasks)
+                {
+                    batch_scratch.resize(tasks);
+                }
+                pool->parallel_for(
+                    tasks,
+                    [&](const size_t task)
+                    {
+                        for (size_t i = task; i < size; i += tasks)
+                        {
+                            infer(i, batch_scratch[task]);
+                        }
+                    });
+            }
+            else
+            {
+                for (size_t i = 0; i < size; ++i)
+                {
+                    infer(i, scratch);
+                }
             }
         }
 
@@ -82,17 +167,126 @@ struct MonteCarloModel : Types
         }
 
     protected:
-        void rollout(Types::State &state)
+        struct Scratch
+        {
+            std::vector<typename Types::State> states;
+            std::vector<size_t> live;
+        };
+
+        void inference(
+            Types::PRNG &device,
+            Types::State &&state,
+            ModelOutput &output,
+            Scratch &scratch) const
+        {
+            set_policy(state, output);
+            const size_t rollouts = std::max(options.rollouts, size_t{1});
+            if (rollouts == 1)
+            {
+                output.value = rollout(device, state);
+                return;
+            }
+            typename Types::Value total{};
+            if (options.interleave)
+            {
+                // states are only copy constructed, since they need not be assignable.
+                // the indices of the unfinished playouts are kept at the front of `live`
+                auto &states = scratch.states;
+                auto &live = scratch.live;
+                states.clear();
+                live.clear();
+                for (size_t i = 0; i < rollouts; ++i)
+                {
+                    states.emplace_back(state);
+                    live.push_back(i);
+                }
+                size_t remaining = rollouts;
+                for (size_t depth = 0; remaining > 0; ++depth)
+                {
+                    for (size_t k = 0; k < remaining;)
+                    {
+                        typename Types::State &playout = states[live[k]];
+                        if (playout.is_terminal() || is_cut_off(depth))
+                        {
+                            total += get_leaf_value(playout);
+                            live[k] = live[--remaining];
+                            continue;
+                        }
+                        step(device, playout);
+                        ++k;
+                    }
+                }
+            }
+            else
+            {
+                for (size_t i = 1; i < rollouts; ++i)
+                {
+                    typename Types::State state_copy{state};
+                    total += rollout(device, state_copy);
+                }
+                total += rollout(device, state);
+            }
+            output.value = total * typename Types::Real{Rational<>{1, static_cast<int>(rollouts)}};
+        }
+
+        static void set_policy(const Types::State &state, ModelOutput &output)
         {
-            while (!state.is_terminal())
+            if constexpr (has_policy)
             {
-                const int row_idx = device.random_int(state.row_actions.size());
-                const int col_idx = device.random_int(state.col_actions.size());
-                const auto row_action = state.row_actions[row_idx];
-                const auto col_action = state.col_actions[col_idx];
-                state.apply_actions(row_action, col_action);
-                state.get_actions();
+                const size_t rows = state.row_actions.size();
+                const size_t cols = state.col_actions.size();
+                const typename Types::Real row_uniform{Rational{1, static_cast<int>(rows)}};
+                output.row_policy.resize(rows, row_uniform);
+                const typename Types::Real col_uniform{Rational{1, static_cast<int>(cols)}};
+                output.col_policy.resize(cols, col_uniform);
             }
         }
+
+        // the value of one playout
+        Types::Value rollout(Types::PRNG &device, Types::State &state) const
+        {
+            size_t depth = 0;
+            for (; !state.is_terminal() && !is_cut_off(depth); ++depth)
+            {
+                step(device, state);
+            }
+            return get_leaf_value(state);
+        }
+
+    private:
+        Scratch scratch{};
+        std::vector<Scratch> batch_scratch{};
+
+        inline bool is_cut_off(const size_t depth) const
+        {
+            return options.max_depth > 0 && depth >= options.max_depth;
+        }
+
+        Types::Value get_leaf_value(const Types::State &state) const
+        {
+            if (state.is_terminal())
+            {
+                return state.get_payoff();
+            }
+            if constexpr (IsHeuristicStateTypes<Types>)
+            {
+                return state.get_heuristic_value();
+            }
+            else
+            {
+                return make_draw<Types>();
+            }
+        }
+
+        void step(Types::PRNG &device, Types::State &state) const
+        {
+            int row_idx, col_idx;
+            policy.sample(device, state, row_idx, col_idx);
+            const auto row_action = state.row_actions[row_idx];
+            const auto col_action = state.col_actions[col_idx];
+            state.randomize_transition(device);
+            state.apply_actions(row_action, col_action);
+            state.get_actions();
+        }
     };
 };
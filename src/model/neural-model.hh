@@ -0,0 +1,603 @@
+#pragma once
+
+#include <model/model.hh>
+#include <model/packed-output.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PINYON_NEURAL_X86
+#endif
+
+/*
+
+A small MLP evaluated on the CPU.
+
+    features -> hidden_1 (ReLU) -> hidden_2 (ReLU) -> value (sigmoid), row logits, col logits
+
+The state provides its input through `get_features(float *)`, which writes `State::n_features` floats,
+see `IsFeatureStateTypes`. The model throws if the network's `inputs` is not `n_features`.
+The policies are the softmax of the first `rows` and `cols` logits, so action `i` is assumed to be policy index `i`.
+Inference throws if a state has more actions than the network's `max_rows` or `max_cols`.
+
+Kernels are chosen at run time: AVX2/FMA if the CPU has it, scalar otherwise.
+If `quantized` is true, the layers after the first use int8 weights (per output row scale)
+and activations quantized to 0..127 (per item scale), with int32 accumulation.
+The first layer stays float since the features may be negative.
+
+Weights file, little endian:
+    uint32 magic 'PNN1', uint32 inputs, hidden_1, hidden_2, max_rows, max_cols
+    then for each of the 5 layers in order: float weights[outputs][inputs], float bias[outputs]
+
+*/
+
+template <typename Types>
+concept IsFeatureStateTypes =
+    requires(
+        const typename Types::State &const_state,
+        float *features) {
+        {
+            const_state.get_features(features)
+        } -> std::same_as<void>;
+        {
+            Types::State::n_features
+        } -> std::convertible_to<size_t>;
+    } &&
+    IsPerfectInfoStateTypes<Types>;
+
+namespace NeuralModelDetail
+{
+    // every vector is padded with zeros to a multiple of this, so kernels have no remainder loop
+    constexpr size_t alignment = 32;
+
+    inline size_t pad(const size_t n)
+    {
+        return (n + alignment - 1) & ~(alignment - 1);
+    }
+
+    inline float dot_scalar(const float *a, const float *b, const size_t n)
+    {
+        float sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    inline int32_t dot_int8_scalar(const uint8_t *a, const int8_t *b, const size_t n)
+    {
+        int32_t sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum += static_cast<int32_t>(a[i]) * b[i];
+        }
+        return sum;
+    }
+
+#ifdef PINYON_NEURAL_X86
+    __attribute__((target("avx2,fma"))) inline float dot_avx2(const float *a, const float *b, const size_t n)
+    {
+        __m256 sum_0 = _mm256_setzero_ps();
+        __m256 sum_1 = _mm256_setzero_ps();
+        for (size_t i = 0; i < n; i += 16)
+        {
+            sum_0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum_0);
+            sum_1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum_1);
+        }
+        const __m256 sum = _mm256_add_ps(sum_0, sum_1);
+        __m128 x = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+        x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+        x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+        return _mm_cvtss_f32(x);
+    }
+
+    // activations are at most 127, so the pairwise int16 sums of maddubs can't saturate
+    __attribute__((target("avx2"))) inline int32_t dot_int8_avx2(const uint8_t *a, const int8_t *b, const size_t n)
+    {
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sum = _mm256_setzero_si256();
+        for (size_t i = 0; i < n; i += 32)
+        {
+            const __m256i products = _mm256_maddubs_epi16(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+        }
+        __m128i x = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0b01001110));
+        x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0b10110001));
+        return _mm_cvtsi128_si32(x);
+    }
+
+    inline bool has_avx2()
+    {
+        static const bool result = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return result;
+    }
+#else
+    inline bool has_avx2()
+    {
+        return false;
+    }
+#endif
+
+    inline float dot(const float *a, const float *b, const size_t n)
+    {
+#ifdef PINYON_NEURAL_X86
+        if (has_avx2())
+        {
+            return dot_avx2(a, b, n);
+        }
+#endif
+        return dot_scalar(a, b, n);
+    }
+
+    inline int32_t dot_int8(const uint8_t *a, const int8_t *b, const size_t n)
+    {
+#ifdef PINYON_NEURAL_X86
+        if (has_avx2())
+        {
+            return dot_int8_avx2(a, b, n);
+        }
+#endif
+        return dot_int8_scalar(a, b, n);
+    }
+
+    // writes x quantized to 0..127 and returns the scale. x is non-negative (after ReLU)
+    inline float quantize_activations(const float *x, uint8_t *x_q, const size_t n)
+    {
+        const float max = *std::max_element(x, x + n);
+        if (max <= 0)
+        {
+            std::fill_n(x_q, n, 0);
+            return 0;
+        }
+        const float scale = max / 127;
+        const float inv_scale = 1 / scale;
+        for (size_t i = 0; i < n; ++i)
+        {
+            x_q[i] = static_cast<uint8_t>(x[i] * inv_scale + .5f);
+        }
+        return scale;
+    }
+
+    struct Layer
+    {
+        size_t inputs = 0;
+        size_t outputs = 0;
+        // outputs x pad(inputs), row major
+        std::vector<float> weights;
+        std::vector<float> bias;
+        std::vector<int8_t> weights_q;
+        std::vector<float> scales;
+
+        Layer() {}
+
+        Layer(const size_t inputs, const size_t outputs)
+            : inputs{inputs}, outputs{outputs}, weights(outputs * pad(inputs)), bias(outputs) {}
+
+        float &weight(const size_t output, const size_t input)
+        {
+            return weights[output * pad(inputs) + input];
+        }
+
+        void quantize()
+        {
+            const size_t stride = pad(inputs);
+            weights_q.assign(outputs * stride, 0);
+            scales.assign(outputs, 0);
+            for (size_t o = 0; o < outputs; ++o)
+            {
+                const float *row = weights.data() + o * stride;
+                float max = 0;
+                for (size_t i = 0; i < inputs; ++i)
+                {
+                    max = std::max(max, std::abs(row[i]));
+                }
+                scales[o] = max / 127;
+                const float inv_scale = max > 0 ? 127 / max : 0;
+                for (size_t i = 0; i < inputs; ++i)
+                {
+                    weights_q[o * stride + i] = static_cast<int8_t>(std::lround(row[i] * inv_scale));
+                }
+            }
+        }
+
+        // x is batch x pad(inputs), y is batch x pad(outputs). Weight rows are reused across the batch
+        void forward(const float *x, float *y, const size_t batch, const bool relu) const
+        {
+            const size_t in_stride = pad(inputs);
+            const size_t out_stride = pad(outputs);
+            for (size_t o = 0; o < outputs; ++o)
+            {
+                const float *row = weights.data() + o * in_stride;
+                for (size_t b = 0; b < batch; ++b)
+                {
+                    const float sum = dot(row, x + b * in_stride, in_stride) + bias[o];
+                    y[b * out_stride + o] = relu ? std::max(sum, 0.0f) : sum;
+                }
+            }
+        }
+
+        void forward_int8(const uint8_t *x_q, const float *x_scales, float *y, const size_t batch, const bool relu) const
+        {
+            const size_t in_stride = pad(inputs);
+            const size_t out_stride = pad(outputs);
+            for (size_t o = 0; o < outputs; ++o)
+            {
+                const int8_t *row = weights_q.data() + o * in_stride;
+                for (size_t b = 0; b < batch; ++b)
+                {
+                    const float sum = dot_int8(x_q + b * in_stride, row, in_stride) * x_scales[b] * scales[o] + bias[o];
+                    y[b * out_stride + o] = relu ? std::max(sum, 0.0f) : sum;
+                }
+            }
+        }
+    };
+
+    class Network
+    {
+    public:
+        static constexpr uint32_t magic = 0x314E4E50; // 'PNN1'
+
+        size_t inputs, hidden_1, hidden_2, max_rows, max_cols;
+        // hidden_1, hidden_2, value, row, col
+        Layer layers[5];
+
+        Network(const size_t inputs, const size_t hidden_1, const size_t hidden_2, const size_t max_rows, const size_t max_cols)
+            : inputs{inputs}, hidden_1{hidden_1}, hidden_2{hidden_2}, max_rows{max_rows}, max_cols{max_cols}
+        {
+            layers[0] = Layer{inputs, hidden_1};
+            layers[1] = Layer{hidden_1, hidden_2};
+            layers[2] = Layer{hidden_2, 1};
+            layers[3] = Layer{hidden_2, max_rows};
+            layers[4] = Layer{hidden_2, max_cols};
+        }
+
+        // uniform in [-1, 1] / sqrt(fan in)
+        template <typename PRNG>
+        void randomize(PRNG &device)
+        {
+            for (Layer &layer : layers)
+            {
+                const float bound = 1 / std::sqrt(static_cast<float>(layer.inputs));
+                for (size_t o = 0; o < layer.outputs; ++o)
+                {
+                    for (size_t i = 0; i < layer.inputs; ++i)
+                    {
+                        layer.weight(o, i) = bound * static_cast<float>(2 * device.uniform() - 1);
+                    }
+                    layer.bias[o] = bound * static_cast<float>(2 * device.uniform() - 1);
+                }
+                layer.quantize();
+            }
+        }
+
+        static Network load(const std::string &path)
+        {
+            std::ifstream file{path, std::ios::binary};
+            if (!file)
+            {
+                throw std::runtime_error("NeuralModel: could not open " + path);
+            }
+            uint32_t header[6];
+            file.read(reinterpret_cast<char *>(header), sizeof(header));
+            if (!file || header[0] != magic)
+            {
+                throw std::runtime_error("NeuralModel: bad header in " + path);
+            }
+            Network network{header[1], header[2], header[3], header[4], header[5]};
+            for (Layer &layer : network.layers)
+            {
+                for (size_t o = 0; o < layer.outputs; ++o)
+                {
+                    file.read(reinterpret_cast<char *>(&layer.weight(o, 0)), layer.inputs * sizeof(float));
+                }
+                file.read(reinterpret_cast<char *>(layer.bias.data()), layer.outputs * sizeof(float));
+                layer.quantize();
+            }
+            if (!file)
+            {
+                throw std::runtime_error("NeuralModel: truncated weights in " + path);
+            }
+            return network;
+        }
+
+        void save(const std::string &path) const
+        {
+            std::ofstream file{path, std::ios::binary};
+            const uint32_t header[6]{
+                magic,
+                static_cast<uint32_t>(inputs),
+                static_cast<uint32_t>(hidden_1),
+                static_cast<uint32_t>(hidden_2),
+                static_cast<uint32_t>(max_rows),
+                static_cast<uint32_t>(max_cols)};
+            file.write(reinterpret_cast<const char *>(header), sizeof(header));
+            for (const Layer &layer : layers)
+            {
+                for (size_t o = 0; o < layer.outputs; ++o)
+                {
+                    file.write(reinterpret_cast<const char *>(layer.weights.data() + o * pad(layer.inputs)), layer.inputs * sizeof(float));
+                }
+                file.write(reinterpret_cast<const char *>(layer.bias.data()), layer.outputs * sizeof(float));
+            }
+            if (!file)
+            {
+                throw std::runtime_error("NeuralModel: could not write " + path);
+            }
+        }
+    };
+
+    // activations for a batch, reused between calls
+    struct Scratch
+    {
+        std::vector<float> hidden_1, hidden_2, value, row, col;
+        std::vector<uint8_t> quantized;
+        std::vector<float> scales;
+
+        void resize(const Network &network, const size_t batch)
+        {
+            hidden_1.resize(batch * pad(network.hidden_1));
+            hidden_2.resize(batch * pad(network.hidden_2));
+            value.resize(batch * pad(1));
+            row.resize(batch * pad(network.max_rows));
+            col.resize(batch * pad(network.max_cols));
+            // padding must stay zero for the next layer's dot products
+            std::fill(hidden_1.begin(), hidden_1.end(), 0);
+            std::fill(hidden_2.begin(), hidden_2.end(), 0);
+            quantized.resize(batch * std::max(pad(network.hidden_1), pad(network.hidden_2)));
+            scales.resize(batch);
+        }
+    };
+
+    // the layers after the first, starting from the activations already in `scratch.hidden_1`
+    template <bool quantized>
+    void forward_from_hidden_1(const Network &network, const size_t batch, Scratch &scratch)
+    {
+        const Layer *layers = network.layers;
+        if constexpr (quantized)
+        {
+            auto quantize = [&](const std::vector<float> &x, const size_t dim)
+            {
+                const size_t stride = pad(dim);
+                for (size_t b = 0; b < batch; ++b)
+                {
+                    scratch.scales[b] = quantize_activations(x.data() + b * stride, scratch.quantized.data() + b * stride, stride);
+                }
+            };
+            quantize(scratch.hidden_1, network.hidden_1);
+            layers[1].forward_int8(scratch.quantized.data(), scratch.scales.data(), scratch.hidden_2.data(), batch, true);
+            quantize(scratch.hidden_2, network.hidden_2);
+            layers[2].forward_int8(scratch.quantized.data(), scratch.scales.data(), scratch.value.data(), batch, false);
+            layers[3].forward_int8(scratch.quantized.data(), scratch.scales.data(), scratch.row.data(), batch, false);
+            layers[4].forward_int8(scratch.quantized.data(), scratch.scales.data(), scratch.col.data(), batch, false);
+        }
+        else
+        {
+            layers[1].forward(scratch.hidden_1.data(), scratch.hidden_2.data(), batch, true);
+            layers[2].forward(scratch.hidden_2.data(), scratch.value.data(), batch, false);
+            layers[3].forward(scratch.hidden_2.data(), scratch.row.data(), batch, false);
+            layers[4].forward(scratch.hidden_2.data(), scratch.col.data(), batch, false);
+        }
+    }
+
+    template <bool quantized>
+    void forward(const Network &network, const float *features, const size_t batch, Scratch &scratch)
+    {
+        scratch.resize(network, batch);
+        network.layers[0].forward(features, scratch.hidden_1.data(), batch, true);
+        forward_from_hidden_1<quantized>(network, batch, scratch);
+    }
+
+    inline void softmax(const float *logits, const int k, float *policy)
+    {
+        const float max = *std::max_element(logits, logits + k);
+        float sum = 0;
+        for (int i = 0; i < k; ++i)
+        {
+            policy[i] = std::exp(logits[i] - max);
+            sum += policy[i];
+        }
+        for (int i = 0; i < k; ++i)
+        {
+            policy[i] /= sum;
+        }
+    }
+
+    template <typename Types>
+    void softmax(const float *logits, const int k, typename Types::VectorReal &policy)
+    {
+        policy.resize(k);
+        float probs[k];
+        softmax(logits, k, probs);
+        for (int i = 0; i < k; ++i)
+        {
+            policy[i] = typename Types::Real{probs[i]};
+        }
+    }
+
+    inline float sigmoid(const float x)
+    {
+        return 1 / (1 + std::exp(-x));
+    }
+
+    // consumers index the policies by action, so they can not be cut to the network's size
+    inline void check_actions(const Network &network, const int rows, const int cols)
+    {
+        if (rows > static_cast<int>(network.max_rows) || cols > static_cast<int>(network.max_cols))
+        {
+            throw std::runtime_error("NeuralModel: state has more actions than the network's max_rows or max_cols");
+        }
+    }
+
+    // sigmoid value and softmax policies of batch entry `b`
+    template <typename Types, typename ModelOutput>
+    void write_output(const Network &network, const Scratch &scratch, const size_t b, const int rows, const int cols,
+                      ModelOutput &output)
+    {
+        check_actions(network, rows, cols);
+        const float v = sigmoid(scratch.value[b * pad(1)]);
+        if constexpr (Types::Value::IS_CONSTANT_SUM)
+        {
+            output.value = typename Types::Value{typename Types::Real{v}};
+        }
+        else
+        {
+            output.value = typename Types::Value{typename Types::Real{v}, typename Types::Real{1 - v}};
+        }
+        softmax<Types>(scratch.row.data() + b * pad(network.max_rows), rows, output.row_policy);
+        softmax<Types>(scratch.col.data() + b * pad(network.max_cols), cols, output.col_policy);
+    }
+
+    // the same output, quantized straight into a packed batch without any per item vectors
+    template <typename PackedTypes, typename Q>
+    void write_output(const Network &network, const Scratch &scratch, const size_t b, const int rows, const int cols,
+                      PackedBatchOutput<PackedTypes, Q> &batch_output)
+    {
+        check_actions(network, rows, cols);
+        const float v = sigmoid(scratch.value[b * pad(1)]);
+        float row_policy[rows];
+        float col_policy[cols];
+        softmax(scratch.row.data() + b * pad(network.max_rows), rows, row_policy);
+        softmax(scratch.col.data() + b * pad(network.max_cols), cols, col_policy);
+        batch_output.push(v, 1 - v, row_policy, rows, col_policy, cols);
+    }
+};
+
+template <IsFeatureStateTypes Types, bool quantized = false>
+struct NeuralModel : Types
+{
+    using Network = NeuralModelDetail::Network;
+
+    struct ModelOutput
+    {
+        Types::Value value;
+        Types::VectorReal row_policy, col_policy;
+    };
+
+    // padded features of each entry, contiguous
+    struct ModelBatchInput
+    {
+        std::vector<float> features;
+        std::vector<int> rows, cols;
+
+        ModelBatchInput() {}
+
+        ModelBatchInput(const size_t capacity)
+        {
+            rows.reserve(capacity);
+            cols.reserve(capacity);
+        }
+
+        size_t size() const
+        {
+            return rows.size();
+        }
+
+        void clear()
+        {
+            features.clear();
+            rows.clear();
+            cols.clear();
+        }
+    };
+
+    using ModelBatchOutput = std::vector<ModelOutput>;
+
+    class Model
+    {
+    public:
+        std::shared_ptr<const Network> network;
+
+        Model(const std::string &path) : Model{std::make_shared<const Network>(Network::load(path))} {}
+
+        Model(const std::shared_ptr<const Network> &network) : network{network}
+        {
+            // get_features writes n_features floats into a row of pad(inputs)
+            if (network->inputs != Types::State::n_features)
+            {
+                throw std::runtime_error("NeuralModel: network has " + std::to_string(network->inputs) +
+                                         " inputs but the state has " + std::to_string(Types::State::n_features) + " features");
+            }
+        }
+
+        // copies share the network but not the scratch space
+        Model(const Model &other) : network{other.network} {}
+
+        void inference(
+            Types::State &&state,
+            ModelOutput &output)
+        {
+            single_input.clear();
+            add_to_batch_input(std::move(state), single_input);
+            NeuralModelDetail::forward<quantized>(*network, single_input.features.data(), 1, scratch);
+            write_output(0, single_input.rows[0], single_input.cols[0], output);
+        }
+
+        void inference(
+            ModelBatchInput &batch_input,
+            ModelBatchOutput &batch_output)
+        {
+            const size_t batch = batch_input.size();
+            batch_output.resize(batch);
+            NeuralModelDetail::forward<quantized>(*network, batch_input.features.data(), batch, scratch);
+            for (size_t b = 0; b < batch; ++b)
+            {
+                write_output(b, batch_input.rows[b], batch_input.cols[b], batch_output[b]);
+            }
+        }
+
+        template <typename PackedTypes, typename Q>
+        void inference(
+            ModelBatchInput &batch_input,
+            PackedBatchOutput<PackedTypes, Q> &batch_output)
+        {
+            const size_t batch = batch_input.size();
+            batch_output.clear();
+            NeuralModelDetail::forward<quantized>(*network, batch_input.features.data(), batch, scratch);
+            for (size_t b = 0; b < batch; ++b)
+            {
+                NeuralModelDetail::write_output(*network, scratch, b, batch_input.rows[b], batch_input.cols[b], batch_output);
+            }
+        }
+
+        void add_to_batch_input(
+            Types::State &&state,
+            ModelBatchInput &batch_input) const
+        {
+            const size_t stride = NeuralModelDetail::pad(network->inputs);
+            const size_t start = batch_input.features.size();
+            batch_input.features.resize(start + stride, 0);
+            state.get_features(batch_input.features.data() + start);
+            batch_input.rows.push_back(state.row_actions.size());
+            batch_input.cols.push_back(state.col_actions.size());
+        }
+
+        void get_output(
+            ModelOutput &output,
+            ModelBatchOutput &batch_output,
+            const long int index) const
+        {
+            output = batch_output[index];
+        }
+
+    private:
+        NeuralModelDetail::Scratch scratch{};
+        ModelBatchInput single_input{1};
+
+        void write_output(const size_t b, const int rows, const int cols, ModelOutput &output) const
+        {
+            NeuralModelDetail::write_output<Types>(*network, scratch, b, rows, cols, output);
+        }
+    };
+};
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <model/model.hh>
+#include <libpinyon/math.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/*
+
+A batch of model outputs in a handful of flat arrays instead of one ModelOutput (and two heap allocated policies) per item.
+
+Values are stored as floats, one per item for constant sum games and two otherwise.
+Policies are quantized to `Q` (uint8_t or uint16_t) and stored back to back, row policy then column policy,
+with `offsets[i]` the start of item i. `get` dequantizes and renormalizes them, into an output whose vectors
+are reused, so reading a batch allocates nothing once the output has grown to the largest policy.
+
+The same layout is the on-disk format. `write` appends one batch to a stream as a block and `read` reads the next one,
+so self-play can stream batches into a file and training can read them back. A block, little endian:
+    uint32 magic 'PPO1', uint32 bits of Q, uint32 values per item, uint32 items, uint32 total policy length
+    float values[items * values per item], uint16 rows[items], uint16 cols[items], Q policies[total policy length]
+
+PackedModel wraps a batched model so that its ModelBatchOutput is packed. If the model can write a packed batch itself
+(NeuralModel and IncrementalModel can), it does, otherwise the model's own batch output is packed after inference.
+
+*/
+
+template <typename Types, typename Q = uint16_t>
+struct PackedBatchOutput
+{
+    static_assert(std::is_same_v<Q, uint8_t> || std::is_same_v<Q, uint16_t>);
+
+    static constexpr uint32_t magic = 0x314F5050; // 'PPO1'
+    static constexpr size_t value_columns = Types::Value::IS_CONSTANT_SUM ? 1 : 2;
+    static constexpr float scale = std::numeric_limits<Q>::max();
+
+    std::vector<float> values;
+    std::vector<uint16_t> rows, cols;
+    std::vector<uint32_t> offsets;
+    std::vector<Q> policies;
+
+    PackedBatchOutput() {}
+
+    PackedBatchOutput(const size_t capacity)
+    {
+        values.reserve(capacity * value_columns);
+        rows.reserve(capacity);
+        cols.reserve(capacity);
+        offsets.reserve(capacity);
+    }
+
+    size_t size() const
+    {
+        return rows.size();
+    }
+
+    void clear()
+    {
+        values.clear();
+        rows.clear();
+        cols.clear();
+        offsets.clear();
+        policies.clear();
+    }
+
+    // bytes used by the items, not counting spare capacity
+    size_t get_bytes() const
+    {
+        return values.size() * sizeof(float) + (rows.size() + cols.size()) * sizeof(uint16_t) +
+               offsets.size() * sizeof(uint32_t) + policies.size() * sizeof(Q);
+    }
+
+    void push(
+        const float row_value,
+        const float col_value,
+        const float *row_policy,
+        const size_t n_rows,
+        const float *col_policy,
+        const size_t n_cols)
+    {
+        values.push_back(row_value);
+        if constexpr (value_columns == 2)
+        {
+            values.push_back(col_value);
+        }
+        rows.push_back(n_rows);
+        cols.push_back(n_cols);
+        offsets.push_back(policies.size());
+        for (size_t i = 0; i < n_rows; ++i)
+        {
+            policies.push_back(quantize(row_policy[i]));
+        }
+        for (size_t i = 0; i < n_cols; ++i)
+        {
+            policies.push_back(quantize(col_policy[i]));
+        }
+    }
+
+    template <typename ModelOutput>
+    void push(const ModelOutput &output)
+    {
+        const float row_value = math::to_double(output.value.get_row_value());
+        const float col_value = math::to_double(output.value.get_col_value());
+        if constexpr (requires { output.row_policy; })
+        {
+            const size_t n_rows = output.row_policy.size();
+            const size_t n_cols = output.col_policy.size();
+            float row_policy[n_rows];
+            float col_policy[n_cols];
+            for (size_t i = 0; i < n_rows; ++i)
+            {
+                row_policy[i] = math::to_double(output.row_policy[i]);
+            }
+            for (size_t i = 0; i < n_cols; ++i)
+            {
+                col_policy[i] = math::to_double(output.col_policy[i]);
+            }
+            push(row_value, col_value, row_policy, n_rows, col_policy, n_cols);
+        }
+        else
+        {
+            push(row_value, col_value, nullptr, 0, nullptr, 0);
+        }
+    }
+
+    template <typename ModelOutput>
+    void get(const size_t index, ModelOutput &output) const
+    {
+        using Real = typename Types::Real;
+        if constexpr (value_columns == 1)
+        {
+            output.value = typename Types::Value{Real{values[index]}};
+        }
+        else
+        {
+            output.value = typename Types::Value{Real{values[2 * index]}, Real{values[2 * index + 1]}};
+        }
+        if constexpr (requires { output.row_policy; })
+        {
+            const Q *policy = policies.data() + offsets[index];
+            dequantize(policy, rows[index], output.row_policy);
+            dequantize(policy + rows[index], cols[index], output.col_policy);
+        }
+    }
+
+    void write(std::ostream &stream) const
+    {
+        const uint32_t header[5]{
+            magic,
+            static_cast<uint32_t>(8 * sizeof(Q)),
+            static_cast<uint32_t>(value_columns),
+            static_cast<uint32_t>(size()),
+            static_cast<uint32_t>(policies.size())};
+        stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+        stream.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(float));
+        stream.write(reinterpret_cast<const char *>(rows.data()), rows.size() * sizeof(uint16_t));
+        stream.write(reinterpret_cast<const char *>(cols.data()), cols.size() * sizeof(uint16_t));
+        stream.write(reinterpret_cast<const char *>(policies.data()), policies.size() * sizeof(Q));
+        if (!stream)
+        {
+            throw std::runtime_error("PackedBatchOutput: write failed");
+        }
+    }
+
+    // replaces the contents with the next block. Returns false if the stream has no more blocks
+    bool read(std::istream &stream)
+    {
+        uint32_t header[5];
+        if (!stream.read(reinterpret_cast<char *>(header), sizeof(header)))
+        {
+            return false;
+        }
+        if (header[0] != magic || header[1] != 8 * sizeof(Q) || header[2] != value_columns)
+        {
+            throw std::runtime_error("PackedBatchOutput: block does not match this type");
+        }
+        const size_t items = header[3];
+        values.resize(items * value_columns);
+        rows.resize(items);
+        cols.resize(items);
+        policies.resize(header[4]);
+        stream.read(reinterpret_cast<char *>(values.data()), values.size() * sizeof(float));
+        stream.read(reinterpret_cast<char *>(rows.data()), rows.size() * sizeof(uint16_t));
+        stream.read(reinterpret_cast<char *>(cols.data()), cols.size() * sizeof(uint16_t));
+        stream.read(reinterpret_cast<char *>(policies.data()), policies.size() * sizeof(Q));
+        if (!stream)
+        {
+            throw std::runtime_error("PackedBatchOutput: truncated block");
+        }
+        offsets.resize(items);
+        uint32_t offset = 0;
+        for (size_t i = 0; i < items; ++i)
+        {
+            offsets[i] = offset;
+            offset += rows[i] + cols[i];
+        }
+        return true;
+    }
+
+private:
+    static Q quantize(const float p)
+    {
+        return static_cast<Q>(std::lround(std::clamp(p, 0.0f, 1.0f) * scale));
+    }
+
+    // renormalized, since the quantized probabilities need not sum to exactly 1
+    static void dequantize(const Q *policy, const size_t n, Types::VectorReal &output)
+    {
+        using Real = typename Types::Real;
+        output.resize(n);
+        uint32_t sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            sum += policy[i];
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            output[i] = Real{sum > 0 ? static_cast<double>(policy[i]) / sum : 1.0 / n};
+        }
+    }
+};
+
+template <IsBatchModelTypes Types, typename Q = uint16_t>
+struct PackedModel : Types
+{
+    using ModelBatchOutput = PackedBatchOutput<Types, Q>;
+
+    class Model : public Types::Model
+    {
+    public:
+        using Types::Model::Model;
+        using Types::Model::inference;
+
+        Model(const Types::Model &model) : Types::Model{model} {}
+
+        void inference(
+            Types::ModelBatchInput &batch_input,
+            ModelBatchOutput &batch_output)
+        {
+            if constexpr (requires { Types::Model::inference(batch_input, batch_output); })
+            {
+                Types::Model::inference(batch_input, batch_output);
+            }
+            else
+            {
+                Types::Model::inference(batch_input, unpacked);
+                batch_output.clear();
+                for (size_t i = 0; i < batch_input.size(); ++i)
+                {
+                    Types::Model::get_output(output, unpacked, i);
+                    batch_output.push(output);
+                }
+            }
+        }
+
+        void get_output(
+            Types::ModelOutput &model_output,
+            ModelBatchOutput &batch_output,
+            const long int index) const
+        {
+            batch_output.get(index, model_output);
+        }
+
+    private:
+        typename Types::ModelBatchOutput unpacked{};
+        typename Types::ModelOutput output{};
+    };
+};
@@ -3,11 +3,27 @@
 #include <model/model.hh>
 #include <algorithm/algorithm.hh>
 #include <tree/tree.hh>
+#include <tree/node-pool.hh>
+#include <libpinyon/thread-pool.hh>
+
+#include <algorithm>
+#include <memory>
+#include <optional>
 
 /*
 
 Model + Search wrapped as a new model.
 
+The nodes of each call's tree are deleted into `pools` (see NodePool) and the next call builds its tree from them,
+so after the first call a search of the same size allocates no nodes. Batched inference keeps one set of pools per batch index.
+A pool is only in use on the thread that installed it, so searches with worker threads (a `threads` member)
+are not pooled: their nodes would be allocated from the heap and only ever deleted into the pools.
+
+If `tree_cache_size` is positive, the trees of the most recent inference calls are kept, keyed on `State::get_hash()`.
+A call on a state that is in the cache continues searching its tree instead of starting from an empty root.
+For chance states, the expanded children of each searched root are cached as well,
+so a call on a state that was reached by one transition from a previous root also reuses that subtree.
+
 */
 
 namespace SearchModelDetail
@@ -37,7 +53,8 @@ template <
     bool use_policy = true,
     bool use_tree_bandit = true,
     bool use_value = true,
-    bool use_empirical = true>
+    bool use_empirical = true,
+    size_t tree_cache_size = 0>
 struct SearchModel : Types::TypeList
 {
     using State = typename Types::State; // DONT REMOVE
@@ -46,7 +63,87 @@ struct SearchModel : Types::TypeList
     using ModelOutput = SearchModelDetail::ModelOutputImpl<Types, use_policy>;
 
     using ModelBatchInput = std::vector<typename Types::State>;
-    using ModelBatchOutput = std::vector<typename Types::ModelOutput>;
+    using ModelBatchOutput = std::vector<ModelOutput>;
+
+    static constexpr bool use_node_pools = !requires(const typename Types::Search &search) { search.threads; };
+
+    // node memory recycled between calls. Copies start empty
+    struct NodePools
+    {
+        NodePool<typename Types::MatrixNode> matrix_nodes{};
+        NodePool<typename Types::ChanceNode> chance_nodes{};
+
+        // does nothing unless `use_node_pools`
+        class Use
+        {
+        public:
+            Use(NodePools &pools)
+            {
+                if constexpr (use_node_pools)
+                {
+                    matrix_nodes.emplace(pools.matrix_nodes);
+                    chance_nodes.emplace(pools.chance_nodes);
+                }
+            }
+
+        private:
+            std::optional<typename NodePool<typename Types::MatrixNode>::Use> matrix_nodes;
+            std::optional<typename NodePool<typename Types::ChanceNode>::Use> chance_nodes;
+        };
+    };
+
+    // most recently used last. Copies start empty, so that the trees are never shared between threads
+    class TreeCache
+    {
+    public:
+        struct Entry
+        {
+            uint64_t hash;
+            // child entries alias the root they belong to, which keeps the whole tree alive
+            std::shared_ptr<typename Types::MatrixNode> node;
+        };
+        std::vector<Entry> entries;
+
+        TreeCache() {}
+
+        TreeCache(const TreeCache &) {}
+
+        TreeCache &operator=(const TreeCache &)
+        {
+            entries.clear();
+            return *this;
+        }
+
+        std::shared_ptr<typename Types::MatrixNode> find(const uint64_t hash)
+        {
+            for (auto it = entries.begin(); it != entries.end(); ++it)
+            {
+                if (it->hash == hash)
+                {
+                    std::rotate(it, it + 1, entries.end());
+                    return entries.back().node;
+                }
+            }
+            return nullptr;
+        }
+
+        void insert(const uint64_t hash, const std::shared_ptr<typename Types::MatrixNode> &node)
+        {
+            for (auto it = entries.begin(); it != entries.end(); ++it)
+            {
+                if (it->hash == hash)
+                {
+                    entries.erase(it);
+                    break;
+                }
+            }
+            if (entries.size() == tree_cache_size)
+            {
+                entries.erase(entries.begin());
+            }
+            entries.push_back({hash, node});
+        }
+    };
 
     class Model
     {
@@ -56,6 +153,10 @@ struct SearchModel : Types::TypeList
         Types::PRNG device;
         Types::Model model;
         Types::Search search;
+        TreeCache trees{};
+        NodePools pools{};
+        // shared by copies
+        std::shared_ptr<ThreadPool> pool{};
 
         Model(
             const size_t count,
@@ -66,12 +167,96 @@ struct SearchModel : Types::TypeList
         {
         }
 
+        Model(
+            const size_t count,
+            const Types::PRNG &device,
+            const Types::Model &model,
+            const Types::Search &search,
+            const size_t threads)
+            : count{count}, device{device}, model{model}, search{search}, pool{std::make_shared<ThreadPool>(threads)}
+        {
+        }
+
         void inference(
             Types::State &&state,
             ModelOutput &output)
         {
-            typename Types::MatrixNode root{};
+            // evicted or discarded trees are deleted into the pools, and this search allocates from them
+            const typename NodePools::Use use{pools};
+            if constexpr (tree_cache_size > 0)
+            {
+                static_assert(IsHashableStateTypes<Types>, "the tree cache needs State::get_hash()");
+                const uint64_t hash = state.get_hash();
+                std::shared_ptr<typename Types::MatrixNode> root = trees.find(hash);
+                if (root == nullptr)
+                {
+                    root = std::make_shared<typename Types::MatrixNode>();
+                }
+                run_search(state, *root, output);
+                if constexpr (use_tree_bandit && IsChanceStateTypes<Types>)
+                {
+                    insert_children(state, root);
+                }
+                trees.insert(hash, root);
+            }
+            else
+            {
+                typename Types::MatrixNode root{};
+                run_search(state, root, output);
+            }
+        }
+
+        // each entry is searched from an empty root with its own copies of the model and search,
+        // and a device seeded from `device`. So the entries can run in parallel on `pool`,
+        // and the output only depends on the seed. The tree cache is not used
+        void inference(
+            ModelBatchInput &batch_input,
+            ModelBatchOutput &batch_output)
+        {
+            const size_t size = batch_input.size();
+            batch_output.resize(size);
+            batch_pools.resize(std::max(batch_pools.size(), size));
+            std::vector<typename Types::Seed> seeds(size);
+            for (auto &seed : seeds)
+            {
+                seed = device.uniform_64();
+            }
+            auto infer = [&](const size_t i)
+            {
+                const typename NodePools::Use use{batch_pools[i]};
+                Model entry_model{count, typename Types::PRNG{seeds[i]}, model, search};
+                typename Types::MatrixNode root{};
+                entry_model.run_search(batch_input[i], root, batch_output[i]);
+            };
+            if (pool)
+            {
+                pool->parallel_for(size, infer);
+            }
+            else
+            {
+                for (size_t i = 0; i < size; ++i)
+                {
+                    infer(i);
+                }
+            }
+        }
+
+        void add_to_batch_input(
+            Types::State &&state,
+            ModelBatchInput &batch_input) const
+        {
+            batch_input.push_back(state);
+        }
 
+    private:
+        // one per batch index, since the entries may run on different threads
+        std::vector<NodePools> batch_pools{};
+
+        void run_search(
+            const Types::State &state,
+            Types::MatrixNode &root,
+            ModelOutput &output)
+        {
             if constexpr (use_iterations)
             {
                 search.run_for_iterations(count, device, state, model, root);
@@ -116,22 +301,47 @@ struct SearchModel : Types::TypeList
             }
         }
 
-        void inference(
-            ModelBatchInput &batch_input,
-            ModelBatchOutput &batch_output)
+        // caches the expanded children of the root under the hashes of their states
+        void insert_children(
+            Types::State &state,
+            const std::shared_ptr<typename Types::MatrixNode> &root)
         {
-            batch_output.resize(batch_input.size());
-            for (size_t i = 0; i < batch_input.size(); ++i)
+            // with progressive widening the node's action indices are not the state's
+            if constexpr (requires { root->stats.row_order; })
             {
-                inference(batch_input[i], batch_output[i]);
+                return;
+            }
+            const typename Types::MatrixNode &const_root = *root;
+            state.get_actions();
+            std::vector<typename Types::Obs> chance_actions{};
+            for (int row_idx = 0; row_idx < state.row_actions.size(); ++row_idx)
+            {
+                for (int col_idx = 0; col_idx < state.col_actions.size(); ++col_idx)
+                {
+                    const auto *chance_node = const_root.access(row_idx, col_idx);
+                    if (chance_node == nullptr)
+                    {
+                        continue;
+                    }
+                    const auto row_action = state.row_actions[row_idx];
+                    const auto col_action = state.col_actions[col_idx];
+                    state.get_chance_actions(row_action, col_action, chance_actions);
+                    for (const auto &chance_action : chance_actions)
+                    {
+                        const auto *child = chance_node->access(chance_action);
+                        if (child == nullptr || !child->is_expanded())
+                        {
+                            continue;
+                        }
+                        typename Types::State child_state{state};
+                        child_state.apply_actions(row_action, col_action, chance_action);
+                        trees.insert(
+                            child_state.get_hash(),
+                            std::shared_ptr<typename Types::MatrixNode>{
+                                root, const_cast<typename Types::MatrixNode *>(child)});
+                    }
+                }
             }
-        }
-
-        void add_to_batch_input(
-            Types::State &&state,
-            ModelBatchInput &batch_input) const
-        {
-            batch_input.push_back(state);
         }
     };
 };
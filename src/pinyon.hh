@@ -17,6 +17,7 @@
 #include <state/state.hh>
 #include <state/test-states.hh>
 #include <state/random-tree.hh>
+#include <state/hash-random-tree.hh>
 #include <state/traversed.hh>
 #include <state/mapped-state.hh>
 #include <state/model-bandit.hh>
@@ -27,19 +28,34 @@
 #include <model/monte-carlo-model.hh>
 #include <model/search-model.hh>
 #include <model/solved-model.hh>
+#include <model/cached-model.hh>
+#include <model/inference-server.hh>
+#include <model/packed-output.hh>
+#include <model/neural-model.hh>
+#include <model/incremental-model.hh>
+#include <model/lockstep-model.hh>
+#include <model/ensemble-model.hh>
 
 // Algorithm
 
 #include <algorithm/tree-bandit/tree/tree-bandit.hh>
 #include <algorithm/tree-bandit/tree/tree-bandit-flat.hh>
 #include <algorithm/tree-bandit/tree/multithreaded.hh>
+#include <algorithm/tree-bandit/tree/multithreaded-flat.hh>
 #include <algorithm/tree-bandit/tree/off-policy.hh>
+#include <algorithm/tree-bandit/tree/batched.hh>
+#include <algorithm/tree-bandit/tree/scheduler.hh>
+#include <algorithm/tree-bandit/tree/async.hh>
+#include <algorithm/tree-bandit/tree/time-manager.hh>
 
 #include <algorithm/tree-bandit/bandit/exp3.hh>
 #include <algorithm/tree-bandit/bandit/exp3-fat.hh>
 #include <algorithm/tree-bandit/bandit/rand.hh>
 #include <algorithm/tree-bandit/bandit/matrix-ucb.hh>
+#include <algorithm/tree-bandit/bandit/matrix-ucb-incremental.hh>
 #include <algorithm/tree-bandit/bandit/ucb.hh>
+#include <algorithm/tree-bandit/bandit/puct.hh>
+#include <algorithm/tree-bandit/bandit/rm-plus.hh>
 
 #include <algorithm/solver/full-traversal.hh>
 #include <algorithm/solver/alpha-beta.hh>
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <libpinyon/math.hh>
+#include <state/state.hh>
+#include <types/types.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/*
+
+A random tree whose every quantity is a hash of (seed, path) computed on demand.
+
+The state is a handful of words: the path hash, the remaining depth, the payoff bias and the hyper-parameters.
+There is no embedded PRNG to advance and no table of chance strategies, so copying is trivial and a transition
+only hashes the `transitions` chance weights of the chosen joint action. The chance distributions are generated
+like RandomTree's (weights in 1..chance_denominator, zeroed below `chance_threshold`) but with integer arithmetic,
+so the two classes produce different games from the same seed.
+
+*/
+
+template <IsTypeList Types = RandomTreeFloatTypes>
+struct HashRandomTree : Types {
+    class State : public PerfectInfoState<Types> {
+       public:
+        uint64_t path = 0;
+        Types::Seed transition_seed{};
+        size_t depth_bound = 0;
+        size_t rows = 0;
+        size_t cols = 0;
+        size_t transitions = 1;
+        int payoff_bias = 0;
+        typename Types::Q chance_threshold{0};
+        int chance_denominator = 10;
+
+        // everything above determines the abstract game tree exactly
+
+        State(const Types::PRNG &device, size_t depth_bound, size_t rows, size_t cols, size_t transitions,
+              const Types::Q &chance_threshold = typename Types::Q{0})
+            : path{typename Types::PRNG{device}.uniform_64()},
+              depth_bound{depth_bound},
+              rows{rows},
+              cols{cols},
+              transitions{transitions},
+              chance_threshold{chance_threshold} {
+            this->init_range_actions(rows, cols);
+        }
+
+        void randomize_transition(Types::PRNG &device) { transition_seed = device.uniform_64(); }
+
+        void randomize_transition(Types::Seed seed) { transition_seed = seed; }
+
+        void get_actions() { this->init_range_actions(rows, cols); }
+
+        void get_actions(Types::VectorAction &row_actions, Types::VectorAction &col_actions) const {
+            row_actions.resize(rows);
+            col_actions.resize(cols);
+            for (int row_idx = 0; row_idx < rows; ++row_idx) {
+                row_actions[row_idx] = row_idx;
+            };
+            for (int col_idx = 0; col_idx < cols; ++col_idx) {
+                col_actions[col_idx] = col_idx;
+            };
+        }
+
+        void get_chance_actions(const Types::Action row_action, const Types::Action col_action,
+                                std::vector<typename Types::Obs> &chance_actions) const {
+            chance_actions.clear();
+            const uint64_t key = get_key(row_action, col_action);
+            int sum = 0;
+            for (int chance_idx = 0; chance_idx < transitions; ++chance_idx) {
+                const int weight = get_chance_weight(key, chance_idx);
+                sum += weight;
+                if (weight > 0) {
+                    chance_actions.push_back(typename Types::Obs{chance_idx});
+                }
+            }
+            if (sum == 0) {
+                chance_actions.push_back(typename Types::Obs{0});
+            }
+        }
+
+        void apply_actions(Types::Action row_action, Types::Action col_action, Types::Obs chance_action) {
+            const uint64_t key = get_key(row_action, col_action);
+            int weight = 0;
+            int sum = 0;
+            for (int chance_idx = 0; chance_idx < transitions; ++chance_idx) {
+                const int w = get_chance_weight(key, chance_idx);
+                weight += w * (chance_idx == chance_action);
+                sum += w;
+            }
+            apply_transition(key, chance_action, weight, sum);
+        }
+
+        const Types::Prob &get_prob() const { return this->prob; }
+
+        // win, draw or loss for the row player by the sign of the bias
+        static Types::Value get_payoff_from_bias(const int payoff_bias) {
+            typename Types::Q row_payoff{(payoff_bias > 0) - (payoff_bias < 0) + 1, 2};
+            row_payoff.canonicalize();
+            return typename Types::Value{typename Types::Real{row_payoff}};
+        }
+
+        // the terminal payoff if the game ended now
+        Types::Value get_heuristic_value() const { return get_payoff_from_bias(payoff_bias); }
+
+        // the path determines the depth and payoff bias, and the actions are constant
+        uint64_t get_hash() const { return path; }
+
+        static constexpr size_t n_features = 64;
+
+        // for NeuralModel: depth, payoff bias and action counts, then the low bits of the path as +-1
+        void get_features(float *features) const {
+            features[0] = depth_bound;
+            features[1] = payoff_bias;
+            features[2] = rows;
+            features[3] = cols;
+            for (size_t i = 4; i < n_features; ++i) {
+                features[i] = (path >> (i - 4)) & 1 ? 1.0f : -1.0f;
+            }
+        }
+
+        static constexpr size_t n_sparse_features = 80;
+
+        // for IncrementalModel: one-hot depth, payoff bias and action counts, so a transition changes at most 4
+        void get_active_features(std::vector<uint32_t> &features) const {
+            features.clear();
+            features.push_back(std::min<size_t>(depth_bound, 31));
+            features.push_back(32 + std::clamp(payoff_bias + 16, 0, 31));
+            features.push_back(64 + std::min<size_t>(rows, 7));
+            features.push_back(72 + std::min<size_t>(cols, 7));
+        }
+
+        void apply_actions(Types::Action row_action, Types::Action col_action) {
+            const uint64_t key = get_key(row_action, col_action);
+            int weights[transitions];
+            int sum = 0;
+            for (int chance_idx = 0; chance_idx < transitions; ++chance_idx) {
+                weights[chance_idx] = get_chance_weight(key, chance_idx);
+                sum += weights[chance_idx];
+            }
+            if (sum == 0) {
+                apply_transition(key, 0, 0, 0);
+                return;
+            }
+            // exact integer sampling, the transition seed picks a point in [0, sum)
+            int p = math::splitmix64(transition_seed ^ key) % sum;
+            int chance_idx = 0;
+            while (p >= weights[chance_idx]) {
+                p -= weights[chance_idx++];
+            }
+            apply_transition(key, chance_idx, weights[chance_idx], sum);
+        }
+
+       private:
+        static inline uint64_t mix(uint64_t a, uint64_t b) { return math::splitmix64(a ^ math::splitmix64(b)); }
+
+        inline uint64_t get_key(Types::Action row_action, Types::Action col_action) const {
+            return mix(path, (static_cast<uint64_t>(row_action) << 32) | static_cast<uint32_t>(col_action));
+        }
+
+        // unnormalized probability in 0..chance_denominator, same threshold rule as RandomTree
+        inline int get_chance_weight(uint64_t key, int chance_idx) const {
+            const int num = mix(key, chance_idx) % chance_denominator + 1;
+            return num * (num * chance_threshold.q >= chance_threshold.p * chance_denominator);
+        }
+
+        // a zero sum means every weight was thresholded, then chance action 0 has probability 1
+        void apply_transition(uint64_t key, int chance_idx, int weight, int sum) {
+            if (sum == 0) {
+                weight = sum = 1;
+            }
+            typename Types::Q prob{weight, sum};
+            prob.canonicalize();
+            this->obs = typename Types::Obs{chance_idx};
+            this->prob = typename Types::Prob{prob};
+
+            // chance weights use indices below `transitions`, so these don't collide with them
+            path = mix(key, transitions + chance_idx);
+            depth_bound -= depth_bound > 0;
+            payoff_bias += static_cast<int>(path % 3) - 1;
+
+            if (depth_bound == 0) {
+                this->terminal = true;
+                this->payoff = get_payoff_from_bias(payoff_bias);
+            }
+        }
+
+    };
+};
@@ -121,6 +121,28 @@ concept IsChanceStateTypes =
     } &&
     IsPerfectInfoStateTypes<Types>;
 
+// states that can be keyed in a cache, e.g. CachedModel. Equal hashes should mean equivalent states
+template <typename Types>
+concept IsHashableStateTypes =
+    requires(
+        const typename Types::State &const_state) {
+        {
+            const_state.get_hash()
+        } -> std::same_as<uint64_t>;
+    } &&
+    IsStateTypes<Types>;
+
+// an estimate of the payoff of a non-terminal state, e.g. for truncated rollouts
+template <typename Types>
+concept IsHeuristicStateTypes =
+    requires(
+        const typename Types::State &const_state) {
+        {
+            const_state.get_heuristic_value()
+        } -> std::same_as<typename Types::Value>;
+    } &&
+    IsStateTypes<Types>;
+
 template <typename Types>
 concept IsSolvedStateTypes =
     requires(
@@ -64,6 +64,13 @@ struct MoldState : Types
         {
             chance_actions.resize(1);
         }
+
+        // every state with the same depth and number of actions is the same
+        uint64_t get_hash() const
+        {
+            return math::splitmix64(
+                math::splitmix64(math::splitmix64(max_depth) ^ this->row_actions.size()) ^ this->col_actions.size());
+        }
     };
 };
 
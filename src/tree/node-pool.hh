@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/*
+
+Free list for the memory of tree nodes of type `Node`.
+
+A node type opts in by routing its `operator new` and `operator delete` through `NodePool<Node>::allocate`
+and `deallocate`, as `DefaultNodes` and `FlatNodes` do. While a `NodePool<Node>::Use` is alive on a thread,
+nodes that thread deletes are kept in the used pool (up to its `capacity`) and nodes it allocates are taken from it.
+Otherwise nodes are allocated and freed as usual, so the search code does not need to know about the pool.
+
+This is how SearchModel recycles its trees: the tree of one call is deleted into the pool and the next call
+rebuilds from it. Only the nodes themselves are recycled, not allocations owned by their stats.
+
+*/
+
+template <typename Node>
+class NodePool
+{
+public:
+    const size_t capacity;
+
+    NodePool(const size_t capacity = 1 << 16) : capacity{capacity} {}
+
+    // copies start empty
+    NodePool(const NodePool &other) : capacity{other.capacity} {}
+
+    NodePool(NodePool &&other) noexcept : capacity{other.capacity}, free_list{std::move(other.free_list)} {}
+
+    NodePool &operator=(const NodePool &) = delete;
+
+    ~NodePool()
+    {
+        for (void *ptr : free_list)
+        {
+            ::operator delete(ptr, std::align_val_t{alignof(Node)});
+        }
+    }
+
+    size_t size() const
+    {
+        return free_list.size();
+    }
+
+    class Use
+    {
+    public:
+        Use(NodePool &pool) : previous{current()}
+        {
+            current() = &pool;
+        }
+
+        Use(const Use &) = delete;
+
+        ~Use()
+        {
+            current() = previous;
+        }
+
+    private:
+        NodePool *previous;
+    };
+
+    static void *allocate()
+    {
+        NodePool *pool = current();
+        if (pool != nullptr && !pool->free_list.empty())
+        {
+            void *ptr = pool->free_list.back();
+            pool->free_list.pop_back();
+            return ptr;
+        }
+        return ::operator new(sizeof(Node), std::align_val_t{alignof(Node)});
+    }
+
+    static void deallocate(void *ptr)
+    {
+        NodePool *pool = current();
+        if (pool != nullptr && pool->free_list.size() < pool->capacity)
+        {
+            pool->free_list.push_back(ptr);
+            return;
+        }
+        ::operator delete(ptr, std::align_val_t{alignof(Node)});
+    }
+
+private:
+    std::vector<void *> free_list;
+
+    static NodePool *&current()
+    {
+        thread_local NodePool *pool = nullptr;
+        return pool;
+    }
+};
@@ -3,6 +3,7 @@
 #include <libpinyon/math.hh>
 #include <state/state.hh>
 #include <tree/node.hh>
+#include <tree/node-pool.hh>
 
 #include <unordered_map>
 
@@ -35,20 +36,40 @@ struct FlatNodes : Types
 
         MatrixStats stats;
 
-        ChanceNode **edges;
+        ChanceNode **edges = nullptr;
 
         MatrixNode(){};
         MatrixNode(Types::Obs obs) : obs(obs) {}
         MatrixNode(const MatrixNode &) = delete;
         ~MatrixNode();
 
+        static void *operator new(size_t)
+        {
+            return NodePool<MatrixNode>::allocate();
+        }
+
+        static void operator delete(void *ptr)
+        {
+            NodePool<MatrixNode>::deallocate(ptr);
+        }
+
+        // may be called again with more rows and cols (progressive widening), existing edges are kept
         inline void expand(const size_t &rows, const size_t &cols)
         {
+            const size_t n_children = rows * cols;
+            ChanceNode **new_edges = new ChanceNode *[n_children] {};
+            std::fill_n(new_edges, n_children, nullptr);
+            if (edges != nullptr)
+            {
+                for (int row_idx = 0; row_idx < this->rows; ++row_idx)
+                {
+                    std::copy_n(edges + row_idx * this->cols, this->cols, new_edges + row_idx * cols);
+                }
+                delete[] edges;
+            }
+            edges = new_edges;
             this->rows = rows;
             this->cols = cols;
-            const size_t n_children = rows * cols;
-            edges = new ChanceNode *[n_children] {};
-            std::fill_n(edges, n_children, nullptr);
             expanded = true;
         }
 
@@ -87,11 +108,14 @@ struct FlatNodes : Types
             return child;
         };
 
+        // nullptr if the node was not expanded with these actions
         const ChanceNode *access(int row_idx, int col_idx) const
         {
-            const int child_idx = row_idx * cols + col_idx;
-            const ChanceNode *&child = edges[child_idx];
-            return child;
+            if (row_idx >= rows || col_idx >= cols)
+            {
+                return nullptr;
+            }
+            return edges[row_idx * cols + col_idx];
         };
 
         ChanceNode *access(int row_idx, int col_idx, Types::Mutex &mutex)
@@ -138,6 +162,16 @@ struct FlatNodes : Types
         ChanceNode(const ChanceNode &) = delete;
         ~ChanceNode();
 
+        static void *operator new(size_t)
+        {
+            return NodePool<ChanceNode>::allocate();
+        }
+
+        static void operator delete(void *ptr)
+        {
+            NodePool<ChanceNode>::deallocate(ptr);
+        }
+
         MatrixNode *access(const Types::Obs &obs)
         {
             MatrixNode *&child = edges[obs];
@@ -150,7 +184,8 @@ struct FlatNodes : Types
 
         const MatrixNode *access(const Types::Obs &obs) const
         {
-            return edges[obs];
+            const auto it = edges.find(obs);
+            return it == edges.end() ? nullptr : it->second;
         };
 
         MatrixNode *access(const Types::Obs &obs, Types::Mutex &mutex)
@@ -184,6 +219,11 @@ template <IsStateTypes Types, typename MStats, typename CStats,
           typename stores_actions, typename stores_value>
 FlatNodes<Types, MStats, CStats, stores_actions, stores_value>::MatrixNode::~MatrixNode()
 {
+    const size_t n_children = rows * cols;
+    for (size_t i = 0; i < n_children; ++i)
+    {
+        delete edges[i];
+    }
     delete[] edges;
 }
 
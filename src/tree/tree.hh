@@ -3,6 +3,7 @@
 #include <libpinyon/math.hh>
 #include <state/state.hh>
 #include <tree/node.hh>
+#include <tree/node-pool.hh>
 
 /*
 
@@ -48,6 +49,10 @@ struct DefaultNodes : Types {
         MatrixNode(const MatrixNode &) = delete;
         ~MatrixNode();
 
+        static void *operator new(size_t) { return NodePool<MatrixNode>::allocate(); }
+
+        static void operator delete(void *ptr) { NodePool<MatrixNode>::deallocate(ptr); }
+
         inline void expand(const size_t &, const size_t &) { expanded = true; }
 
         inline bool is_terminal() const { return terminal; }
@@ -145,6 +150,10 @@ struct DefaultNodes : Types {
 
         ~ChanceNode();
 
+        static void *operator new(size_t) { return NodePool<ChanceNode>::allocate(); }
+
+        static void operator delete(void *ptr) { NodePool<ChanceNode>::deallocate(ptr); }
+
         MatrixNode *access(const Types::Obs &obs) {
             if (this->child == nullptr) {
                 MatrixNode *child = new MatrixNode(obs);
@@ -2,6 +2,15 @@
 
 #include <array>
 #include <algorithm>
+#include <cassert>
+
+/*
+
+Fixed capacity containers with the vector and matrix interfaces that Pinyon relies on.
+Only the first `size()` elements are live, and copies, fills and comparisons only touch those.
+Growing past the capacity is a bug in the caller, so it is only checked by assertions.
+
+*/
 
 template <size_t MaxSize>
 struct A
@@ -13,43 +22,55 @@ struct A
 
         Array() {}
 
-        Array (const size_t n) {
-            _size = n;
-            std::fill(this->begin(), this->end(), T{});
+        Array(const size_t n) : _size{n}
+        {
+            assert(n <= MaxSize);
+            std::fill_n(this->begin(), n, T{});
         }
 
-        Array(const Array &other)
+        Array(const size_t n, const T &value) : _size{n}
         {
-            _size = other._size;
-            std::copy(other.begin(), other.end(), this->begin());
+            assert(n <= MaxSize);
+            std::fill_n(this->begin(), n, value);
+        }
+
+        Array(const Array &other) : _size{other._size}
+        {
+            std::copy_n(other.begin(), _size, this->begin());
         }
 
         Array &operator=(const Array &other)
         {
             _size = other._size;
-            std::copy(other.begin(), other.end(), this->begin());
+            std::copy_n(other.begin(), _size, this->begin());
             return *this;
         }
 
         bool operator==(const Array &other) const
         {
-            for (int i = 0; i < _size; ++i) {
-                if ((*this)[i] != other[i]) {
-                    return false;
-                }
-            }
-            return _size == other._size;
+            return _size == other._size && std::equal(this->begin(), this->end(), other.begin());
         }
 
+        // like std::vector, only the new elements are assigned
         void resize(size_t n, T value)
         {
+            assert(n <= MaxSize);
+            if (n > _size)
+            {
+                std::fill(this->begin() + _size, this->begin() + n, value);
+            }
             _size = n;
-            std::fill(this->begin(), this->end(), value);
         }
 
         void resize(size_t n)
         {
-            _size = n;
+            resize(n, T{});
+        }
+
+        void push_back(const T &value)
+        {
+            assert(_size < MaxSize);
+            (*this)[_size++] = value;
         }
 
         size_t size() const
@@ -57,7 +78,13 @@ struct A
             return _size;
         }
 
-        void clear () {
+        bool empty() const
+        {
+            return _size == 0;
+        }
+
+        void clear()
+        {
             _size = 0;
         }
 
@@ -71,4 +98,80 @@ struct A
             return std::array<T, MaxSize>::begin() + _size;
         }
     };
+
+    // row-major, with room for a MaxSize x MaxSize matrix
+    template <typename T>
+    struct Matrix : A<MaxSize * MaxSize>::template Array<T>
+    {
+        using Base = A<MaxSize * MaxSize>::template Array<T>;
+
+        size_t rows = 0, cols = 0;
+
+        Matrix() {}
+
+        Matrix(size_t rows, size_t cols) : Base(rows * cols), rows(rows), cols(cols)
+        {
+        }
+
+        void fill(size_t rows, size_t cols)
+        {
+            this->rows = rows;
+            this->cols = cols;
+            this->resize(rows * cols);
+        }
+
+        void fill(size_t rows, size_t cols, T value)
+        {
+            this->rows = rows;
+            this->cols = cols;
+            assert(rows * cols <= MaxSize * MaxSize);
+            this->_size = rows * cols;
+            std::fill(this->begin(), this->end(), value);
+        }
+
+        T &get(size_t i, size_t j)
+        {
+            return (*this)[i * cols + j];
+        }
+
+        const T &get(size_t i, size_t j) const
+        {
+            return (*this)[i * cols + j];
+        }
+
+        // for a matrix of values, the largest row or col value
+        auto max() const
+        {
+            if constexpr (requires(const T &value) { value.get_row_value(); })
+            {
+                auto max = this->begin()->get_row_value();
+                for (const T &value : *this)
+                {
+                    max = std::max({max, value.get_row_value(), value.get_col_value()});
+                }
+                return max;
+            }
+            else
+            {
+                return *std::max_element(this->begin(), this->end());
+            }
+        }
+
+        auto min() const
+        {
+            if constexpr (requires(const T &value) { value.get_row_value(); })
+            {
+                auto min = this->begin()->get_row_value();
+                for (const T &value : *this)
+                {
+                    min = std::min({min, value.get_row_value(), value.get_col_value()});
+                }
+                return min;
+            }
+            else
+            {
+                return *std::min_element(this->begin(), this->end());
+            }
+        }
+    };
 };
@@ -2,6 +2,7 @@
 
 #include <types/value.hh>
 
+#include <array>
 #include <vector>
 #include <algorithm>
 
@@ -146,6 +147,35 @@ public:
         return output;
     }
 
+    // in-place versions of the above, which don't allocate a temporary
+
+    Matrix &operator*=(T t)
+    {
+        for (size_t i = 0; i < rows * cols; ++i)
+        {
+            (*this)[i] = (*this)[i] * t;
+        }
+        return *this;
+    }
+
+    Matrix &operator+=(T t)
+    {
+        for (size_t i = 0; i < rows * cols; ++i)
+        {
+            (*this)[i] = (*this)[i] + t;
+        }
+        return *this;
+    }
+
+    Matrix &operator+=(const Matrix &t)
+    {
+        for (size_t i = 0; i < rows * cols; ++i)
+        {
+            (*this)[i] = (*this)[i] + t[i];
+        }
+        return *this;
+    }
+
     T max() const
     {
         const size_t entries = rows * cols;
@@ -285,6 +315,35 @@ public:
         return output;
     }
 
+    template <typename U>
+    Matrix &operator*=(U t)
+    {
+        for (size_t i = 0; i < rows * cols; ++i)
+        {
+            (*this)[i] = (*this)[i] * t;
+        }
+        return *this;
+    }
+
+    template <typename U>
+    Matrix &operator+=(U t)
+    {
+        for (size_t i = 0; i < rows * cols; ++i)
+        {
+            (*this)[i] = (*this)[i] + t;
+        }
+        return *this;
+    }
+
+    Matrix &operator+=(const Matrix &t)
+    {
+        for (size_t i = 0; i < rows * cols; ++i)
+        {
+            (*this)[i] = (*this)[i] + t[i];
+        }
+        return *this;
+    }
+
     Real max() const
     {
         const size_t entries = rows * cols;
@@ -333,3 +392,323 @@ public:
         }
     }
 };
+
+/*
+
+Matrix with inline storage for up to MaxRows x MaxCols entries, which only allocates beyond that.
+`SmallMatrix<R, C>::Matrix` has the same template signature as `Matrix`, so it can be used as the `_Matrix` parameter of `DefaultTypes`.
+It also serves as the inline `DataMatrix`, since its arithmetic is only instantiated when used. See `DataMatrixOf`.
+
+*/
+
+template <size_t MaxRows, size_t MaxCols = MaxRows>
+struct SmallMatrix
+{
+    template <typename T>
+    class Matrix
+    {
+        static constexpr size_t capacity = MaxRows * MaxCols;
+
+        std::array<T, capacity> inline_data;
+        std::vector<T> heap_data;
+        T *data_ = inline_data.data();
+        size_t entries = 0;
+
+    public:
+        size_t rows = 0, cols = 0;
+
+        template <typename U>
+        using DataMatrix = Matrix<U>;
+
+        Matrix() {}
+
+        Matrix(size_t rows, size_t cols)
+        {
+            fill(rows, cols);
+        }
+
+        Matrix(const Matrix &other)
+        {
+            assign(other.begin(), other.rows, other.cols);
+        }
+
+        Matrix(Matrix &&other) noexcept
+        {
+            move(std::move(other));
+        }
+
+        template <typename U>
+        explicit Matrix(const Matrix<U> &matrix)
+        {
+            reshape(matrix.rows, matrix.cols);
+            std::transform(
+                matrix.begin(), matrix.end(), this->begin(), [](const U &element)
+                { return static_cast<T>(element); });
+        }
+
+        Matrix &operator=(const Matrix &other)
+        {
+            if (this != &other)
+            {
+                assign(other.begin(), other.rows, other.cols);
+            }
+            return *this;
+        }
+
+        Matrix &operator=(Matrix &&other) noexcept
+        {
+            if (this != &other)
+            {
+                move(std::move(other));
+            }
+            return *this;
+        }
+
+        T *data() { return data_; }
+        const T *data() const { return data_; }
+        T *begin() { return data_; }
+        const T *begin() const { return data_; }
+        T *end() { return data_ + entries; }
+        const T *end() const { return data_ + entries; }
+        size_t size() const { return entries; }
+
+        T &operator[](size_t i) { return data_[i]; }
+        const T &operator[](size_t i) const { return data_[i]; }
+
+        // keeps any heap storage
+        void clear()
+        {
+            rows = cols = entries = 0;
+        }
+
+        // like `Matrix`, existing entries are kept in memory order and new entries are value-initialized
+        void fill(size_t rows, size_t cols)
+        {
+            const size_t old_entries = entries;
+            reshape(rows, cols);
+            if (entries > old_entries)
+            {
+                std::fill(data_ + old_entries, data_ + entries, T{});
+            }
+        }
+
+        void fill(size_t rows, size_t cols, T value)
+        {
+            reshape(rows, cols);
+            std::fill(data_, data_ + entries, value);
+        }
+
+        T &get(size_t i, size_t j)
+        {
+            return data_[i * cols + j];
+        }
+
+        const T &get(size_t i, size_t j) const
+        {
+            return data_[i * cols + j];
+        }
+
+        template <typename U>
+        Matrix operator*(U t) const
+        {
+            Matrix output{*this};
+            return output *= t;
+        }
+
+        template <typename U>
+        Matrix operator+(U t) const
+        {
+            Matrix output{*this};
+            return output += t;
+        }
+
+        Matrix operator+(const Matrix &t) const
+        {
+            Matrix output{*this};
+            return output += t;
+        }
+
+        template <typename U>
+        Matrix &operator*=(U t)
+        {
+            for (size_t i = 0; i < entries; ++i)
+            {
+                data_[i] = data_[i] * t;
+            }
+            return *this;
+        }
+
+        template <typename U>
+        Matrix &operator+=(U t)
+        {
+            for (size_t i = 0; i < entries; ++i)
+            {
+                data_[i] = data_[i] + t;
+            }
+            return *this;
+        }
+
+        Matrix &operator+=(const Matrix &t)
+        {
+            for (size_t i = 0; i < entries; ++i)
+            {
+                data_[i] = data_[i] + t[i];
+            }
+            return *this;
+        }
+
+        // for a matrix of values, the largest row or col value
+        auto max() const
+        {
+            if constexpr (requires(const T &value) { value.get_row_value(); })
+            {
+                auto max = data_[0].get_row_value();
+                for (size_t i = 0; i < entries; ++i)
+                {
+                    max = std::max({max, data_[i].get_row_value(), data_[i].get_col_value()});
+                }
+                return max;
+            }
+            else
+            {
+                return *std::max_element(begin(), end());
+            }
+        }
+
+        auto min() const
+        {
+            if constexpr (requires(const T &value) { value.get_row_value(); })
+            {
+                auto min = data_[0].get_row_value();
+                for (size_t i = 0; i < entries; ++i)
+                {
+                    min = std::min({min, data_[i].get_row_value(), data_[i].get_col_value()});
+                }
+                return min;
+            }
+            else
+            {
+                return *std::min_element(begin(), end());
+            }
+        }
+
+        void print() const
+        {
+            for (size_t row_idx = 0; row_idx < rows; ++row_idx)
+            {
+                for (size_t col_idx = 0; col_idx < cols; ++col_idx)
+                {
+                    std::cout << get(row_idx, col_idx) << ' ';
+                }
+                std::cout << std::endl;
+            }
+        }
+
+        // false once the matrix has moved to the heap
+        bool is_inline() const
+        {
+            return data_ == inline_data.data();
+        }
+
+    private:
+        // sets the shape, moving to the heap if needed. Entries are only preserved in memory order
+        void reshape(size_t rows, size_t cols)
+        {
+            const size_t n = rows * cols;
+            if (n > capacity)
+            {
+                if (is_inline())
+                {
+                    heap_data.resize(n);
+                    std::copy(data_, data_ + std::min(entries, n), heap_data.begin());
+                }
+                else
+                {
+                    heap_data.resize(n);
+                }
+                data_ = heap_data.data();
+            }
+            this->rows = rows;
+            this->cols = cols;
+            entries = n;
+        }
+
+        void assign(const T *other_data, size_t rows, size_t cols)
+        {
+            entries = 0;
+            reshape(rows, cols);
+            std::copy(other_data, other_data + entries, data_);
+        }
+
+        void move(Matrix &&other)
+        {
+            if (other.is_inline())
+            {
+                assign(other.begin(), other.rows, other.cols);
+            }
+            else
+            {
+                heap_data = std::move(other.heap_data);
+                data_ = heap_data.data();
+                rows = other.rows;
+                cols = other.cols;
+                entries = other.entries;
+                other.data_ = other.inline_data.data();
+                other.clear();
+            }
+        }
+    };
+};
+
+/*
+
+The container bandits keep their per joint action data in. That is `DataMatrix`,
+unless the type list's matrix provides its own, as `SmallMatrix` does to keep the data inline.
+
+*/
+
+template <typename Types, typename T>
+struct DataMatrixOf
+{
+    using type = DataMatrix<T>;
+};
+
+template <typename Types, typename T>
+    requires requires { typename Types::MatrixReal::template DataMatrix<T>; }
+struct DataMatrixOf<Types, T>
+{
+    using type = typename Types::MatrixReal::template DataMatrix<T>;
+};
+
+/*
+
+Resizes `matrix` to `rows` x `cols`, keeping each existing entry at its (row, col) rather than at its position in memory.
+New entries are value-initialized. Bandits use this so that progressive widening can grow their stats.
+
+*/
+
+template <typename Matrix>
+void resize_entries(Matrix &matrix, const size_t rows, const size_t cols)
+{
+    // a default constructed DataMatrix does not initialize its shape
+    if (matrix.size() == 0)
+    {
+        matrix.fill(rows, cols, {});
+        return;
+    }
+    if (matrix.rows == rows && matrix.cols == cols)
+    {
+        return;
+    }
+    const Matrix old{matrix};
+    matrix.fill(rows, cols, {});
+    const size_t common_rows = std::min(rows, old.rows);
+    const size_t common_cols = std::min(cols, old.cols);
+    for (size_t row_idx = 0; row_idx < common_rows; ++row_idx)
+    {
+        for (size_t col_idx = 0; col_idx < common_cols; ++col_idx)
+        {
+            matrix.get(row_idx, col_idx) = old.get(row_idx, col_idx);
+        }
+    }
+}
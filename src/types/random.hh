@@ -3,8 +3,22 @@
 #include <gmpxx.h>
 
 #include <array>
+#include <cstdint>
 #include <random>
 
+namespace math {
+
+// splitmix64 finalizer. Cheap and all bits of the input affect all bits of the output,
+// so the low bits can be used directly as a power-of-two table index
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+    return x ^ (x >> 31);
+}
+
+}  // namespace math
+
 class prng {
     std::mt19937::result_type seed;
     std::mt19937 engine;
@@ -119,3 +133,98 @@ class xor_shift {
         return state;
     }
 };
+
+/*
+Philox2x64-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+
+Counter-based: the output is a bijective hash of (key, counter), so `discard` is O(1) and the whole state is 64 bytes,
+against about 5 KB for `prng`. The key is derived from the seed, and `stream` sets the high word of the counter,
+so generators with the same seed and different streams never overlap.
+*/
+
+class philox {
+    uint64_t seed;
+    uint64_t key;
+    // index of the next block. The high word is the stream
+    __uint128_t counter;
+    uint64_t block[2];
+    // index of the next unused word in `block`. 2 means there is none
+    uint32_t index = 2;
+
+   public:
+    philox() : philox(std::random_device{}()) {}
+    philox(uint64_t seed) : philox(seed, 0) {}
+    philox(uint64_t seed, uint64_t stream)
+        : seed{seed}, key{math::splitmix64(seed)}, counter{static_cast<__uint128_t>(stream) << 64} {}
+
+    uint64_t get_seed() const { return seed; }
+
+    uint64_t random_seed() { return uniform_64(); }
+
+    // Uniform random in (0, 1)
+    double uniform() { return (static_cast<double>(uniform_64() >> 11) + .5) * 0x1.0p-53; }
+
+    // Random integer in [0, n)
+    int random_int(int n) { return static_cast<int>((static_cast<__uint128_t>(uniform_64()) * n) >> 64); }
+
+    uint64_t uniform_64() {
+        if (index == 2) {
+            generate();
+            index = 0;
+        }
+        return block[index++];
+    }
+
+    template <template <typename...> typename Vector, typename T>
+        requires(!std::is_same_v<T, mpq_class>)
+    int sample_pdf(const Vector<T> &input) {
+        double p = uniform();
+        for (int i = 0; i < input.size(); ++i) {
+            p -= static_cast<double>(input[i]);
+            if (p <= 0) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    template <template <typename...> typename Vector>
+    int sample_pdf(const Vector<mpq_class> &input) {
+        double p = uniform();
+        for (int i = 0; i < input.size(); ++i) {
+            p -= input[i].get_d();
+            if (p <= 0) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    // same as `n` calls of `uniform_64`, in constant time
+    void discard(size_t n) {
+        const __uint128_t position = (index == 2 ? 2 * counter : 2 * (counter - 1) + index) + n;
+        counter = position / 2;
+        index = 2;
+        if (position % 2) {
+            generate();
+            index = 1;
+        }
+    }
+
+   private:
+    void generate() {
+        uint64_t x0 = static_cast<uint64_t>(counter), x1 = static_cast<uint64_t>(counter >> 64);
+        uint64_t k = key;
+        for (int round = 0; round < 10; ++round) {
+            const __uint128_t product = static_cast<__uint128_t>(0xD2B74407B1CE6E93) * x0;
+            const uint64_t hi = static_cast<uint64_t>(product >> 64);
+            const uint64_t lo = static_cast<uint64_t>(product);
+            x0 = hi ^ k ^ x1;
+            x1 = lo;
+            k += 0x9E3779B97F4A7C15;
+        }
+        block[0] = x0;
+        block[1] = x1;
+        ++counter;
+    }
+};
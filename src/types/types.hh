@@ -246,6 +246,56 @@ using RandomTreeRationalTypes = DefaultTypes<
     mpq_class,
     ConstantSum<1, 1>::Value>;
 
+/*
+
+Same as DefaultTypes, but with fixed capacity vectors and matrices for games with at most `max_actions` actions.
+States and bandit stats then have no heap allocations for actions or per-action data.
+
+*/
+
+template <
+    size_t max_actions,
+    typename _Real,
+    typename _Action,
+    typename _Obs,
+    typename _Prob,
+
+    template <typename...> typename _Value = PairReal,
+
+    typename _Mutex = std::mutex,
+    typename _Seed = uint64_t,
+    typename _PRNG = prng,
+    typename _Rational = Rational<int>>
+using ArrayTypes = DefaultTypes<
+    _Real,
+    _Action,
+    _Obs,
+    _Prob,
+    _Value,
+    A<max_actions>::template Array,
+    A<max_actions>::template Matrix,
+    _Mutex,
+    _Seed,
+    _PRNG,
+    _Rational>;
+
+template <size_t max_actions>
+using SimpleArrayTypes = ArrayTypes<
+    max_actions,
+    double,
+    int,
+    int,
+    double>;
+
+template <size_t max_actions>
+using RandomTreeFloatArrayTypes = ArrayTypes<
+    max_actions,
+    double,
+    int,
+    int,
+    double,
+    ConstantSum<1, 1>::Value>;
+
 using SimpleTypesSpinLock = DefaultTypes<
     double,
     int,
@@ -0,0 +1,87 @@
+#include <pinyon.hh>
+
+/*
+
+Check that the fixed capacity containers copy and compare only their live elements,
+and that a search works with them in place of std::vector.
+
+*/
+
+using Array = A<4>::Array<int>;
+using M = A<3>::Matrix<double>;
+
+static_assert(IsMatrix<M, double>);
+
+void test_copy_compare()
+{
+    Array a(3, 1);
+    a.push_back(2);
+    assert(a.size() == 4 && a[3] == 2);
+
+    // the dead element differs, but it is not part of the value
+    Array b(4, 7);
+    b.resize(2);
+    b.resize(3, 1);
+    assert(b.size() == 3 && b[0] == 7 && b[2] == 1);
+    a.resize(3);
+    a[0] = 7;
+    a[1] = 7;
+    assert(a == b);
+
+    Array copy{a};
+    assert(copy == a && copy.size() == 3);
+    assert(!(copy == Array(3)));
+
+    // assignment copies the live elements and size
+    Array assigned(4, 5);
+    assigned = a;
+    assert(assigned == a && assigned.size() == 3);
+    assigned.push_back(9);
+    assert(!(assigned == a));
+
+    Array empty{};
+    assert(empty.empty() && empty.end() == empty.begin());
+    a.clear();
+    assert(a == empty);
+}
+
+void test_matrix()
+{
+    M matrix{2, 3};
+    assert(matrix.size() == 6 && matrix.max() == 0);
+    matrix.get(1, 2) = 4;
+    matrix.get(0, 1) = -1;
+    assert(matrix[5] == 4 && matrix.max() == 4 && matrix.min() == -1);
+
+    M copy{matrix};
+    assert(copy == matrix && copy.get(1, 2) == 4);
+
+    matrix.fill(3, 3, 2.0);
+    assert(matrix.size() == 9 && matrix.min() == 2 && matrix.max() == 2);
+    assert(!(copy == matrix));
+}
+
+void test_search()
+{
+    using Types = TreeBandit<Exp3<MonteCarloModel<MoldState<SimpleArrayTypes<3>>>>>;
+    const Types::State state{3, 3};
+    Types::Model model{prng{0}};
+    Types::Search search{};
+    Types::MatrixNode root{};
+    prng device{0};
+    search.run_for_iterations(1 << 10, device, state, model, root);
+
+    Types::VectorReal row_strategy, col_strategy;
+    search.get_empirical_strategies(root.stats, row_strategy, col_strategy);
+    assert(row_strategy.size() == 3 && col_strategy.size() == 3);
+    const Types::State copy{state};
+    assert(copy.row_actions == state.row_actions && copy.row_actions.size() == 3);
+}
+
+int main()
+{
+    test_copy_compare();
+    test_matrix();
+    test_search();
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <pinyon.hh>
+
+/*
+
+Check that the async handle can be polled while the search is running, and that
+`stop`, `extend` and ponder mode behave for the single and multithreaded tree bandits.
+
+*/
+
+template <typename Types>
+void test_async(const typename Types::Search &base_search)
+{
+    using AsyncTypes = AsyncSearch<Types>;
+
+    typename Types::PRNG device{0};
+    typename Types::State state{3, 20};
+    typename Types::Model model{0};
+    typename Types::MatrixNode root{};
+    typename AsyncTypes::Search search{base_search, 1 << 6};
+
+    typename Types::VectorReal row_strategy, col_strategy;
+    typename Types::Value value;
+
+    {
+        auto handle = search.start(200, device, state, model, root);
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        const size_t polled_iterations = handle.poll(row_strategy, col_strategy, value);
+        assert(handle.is_running());
+        handle.extend(100);
+        const size_t iterations = handle.wait();
+        assert(!handle.is_running());
+        assert(iterations >= polled_iterations);
+        handle.poll(row_strategy, col_strategy, value);
+        assert(row_strategy.size() == 3 && col_strategy.size() == 3);
+        std::cout << search << " : " << iterations << std::endl;
+    }
+
+    {
+        auto handle = search.ponder(device, state, model, root);
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        assert(handle.is_pondering());
+        handle.ponder_hit(50);
+        assert(!handle.is_pondering());
+        const size_t iterations = handle.wait();
+        assert(iterations > 0);
+    }
+
+    {
+        auto handle = search.ponder(device, state, model, root);
+        const size_t iterations = handle.stop();
+        assert(!handle.is_running());
+        std::cout << "stopped after " << iterations << std::endl;
+    }
+}
+
+int main()
+{
+    using BaseTypes = MonteCarloModel<MoldState<>>;
+
+    test_async<TreeBandit<Exp3<BaseTypes>>>({});
+    test_async<TreeBanditThreaded<Exp3<BaseTypes>>>({{}, 4});
+    test_async<TreeBanditThreadPool<Exp3<BaseTypes>>>({{}, 4, 64});
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <pinyon.hh>
+
+/*
+
+Check that the batched search visits the root exactly once per backed up path,
+and that a batch never evaluates the same leaf twice.
+
+*/
+
+template <typename Types>
+struct CountingModel : Types
+{
+    class Model : public Types::Model
+    {
+    public:
+        using Types::Model::Model;
+
+        size_t calls = 0;
+        size_t evaluated = 0;
+
+        void inference(
+            Types::ModelBatchInput &batch_input,
+            Types::ModelBatchOutput &batch_output)
+        {
+            ++calls;
+            evaluated += batch_input.size();
+            Types::Model::inference(batch_input, batch_output);
+        }
+    };
+};
+
+int main()
+{
+    using Types = TreeBanditBatched<Exp3<CountingModel<MonteCarloModel<MoldState<>>>>>;
+
+    const size_t batch_size = 16;
+    const size_t iterations = 1 << 12;
+
+    Types::PRNG device{0};
+    Types::State state{3, 20};
+    Types::Model model{0};
+    Types::MatrixNode root{};
+    Types::Search search{{}, batch_size};
+
+    search.run_for_iterations(iterations, device, state, model, root);
+
+    // MoldState has no terminal nodes before depth 20, so every path ends with an evaluated leaf
+    assert(model.evaluated == iterations);
+    assert(model.calls < iterations);
+    assert(model.calls * batch_size >= iterations);
+    assert(root.count_matrix_nodes() == iterations);
+
+    Types::VectorReal row_strategy, col_strategy;
+    search.get_empirical_strategies(root.stats, row_strategy, col_strategy);
+    assert(row_strategy.size() == 3 && col_strategy.size() == 3);
+
+    std::cout << search << " : " << model.calls << " inference calls" << std::endl;
+
+    return 0;
+}
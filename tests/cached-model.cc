@@ -0,0 +1,81 @@
+#include <pinyon.hh>
+
+/*
+
+Check that CachedModel returns the first output for a repeated state, counts hits and misses,
+that copies of the model share the cache, including between the threads of a search,
+and that states which differ only in their number of actions do not share an entry.
+
+*/
+
+using MonteCarlo = MonteCarloModel<HashRandomTree<>>;
+using Types = CachedModel<MonteCarlo>;
+
+static_assert(IsSingleModelTypes<Types>);
+
+void test_repeated_state()
+{
+    Types::Model model{MonteCarlo::Model{prng{0}}, 4};
+    const Types::State state{prng{0}, 20, 3, 3, 2};
+
+    Types::ModelOutput first, second;
+    model.inference(Types::State{state}, first);
+    assert(model.get_hits() == 0 && model.get_misses() == 1);
+    model.inference(Types::State{state}, second);
+    assert(model.get_hits() == 1 && model.get_misses() == 1);
+    assert(first.value.get_row_value() == second.value.get_row_value());
+
+    // a copy shares the cache
+    Types::Model model_copy{model};
+    model_copy.inference(Types::State{state}, second);
+    assert(model.get_hits() == 2);
+    assert(first.value.get_row_value() == second.value.get_row_value());
+
+    Types::State child{state};
+    child.randomize_transition(0);
+    child.apply_actions(0, 0);
+    model.inference(std::move(child), second);
+    assert(model.get_misses() == 2);
+}
+
+void test_threaded_search()
+{
+    using SearchTypes = TreeBanditThreaded<Exp3<Types>>;
+    Types::Model model{MonteCarlo::Model{prng{0}}, 8};
+    const SearchTypes::State state{prng{0}, 4, 2, 2, 1};
+    SearchTypes::Search search{SearchTypes::BanditAlgorithm{.1}, 4};
+    prng device{0};
+    // each state is only expanded once per search, so hits come from the second search
+    for (int i = 0; i < 2; ++i)
+    {
+        SearchTypes::MatrixNode root{};
+        search.run_for_iterations(1 << 12, device, state, model, root);
+    }
+    // a depth 4 tree with one transition has 1 + 4 + 16 + 64 non-terminal states
+    // misses beyond that are busy entries or threads expanding the same state at once
+    assert(model.get_misses() < 1 << 8);
+    assert(model.get_hits() > 0);
+}
+
+void test_action_count()
+{
+    using MoldTypes = CachedModel<MonteCarloModel<MoldState<>, true>>;
+    const MoldTypes::State small{2, 5}, large{3, 5};
+    assert(small.get_hash() != large.get_hash());
+    assert(small.get_hash() == MoldTypes::State{small}.get_hash());
+
+    MoldTypes::Model model{MonteCarloModel<MoldState<>, true>::Model{prng{0}}, 4};
+    MoldTypes::ModelOutput output;
+    model.inference(MoldTypes::State{small}, output);
+    model.inference(MoldTypes::State{large}, output);
+    assert(model.get_hits() == 0 && model.get_misses() == 2);
+    assert(output.row_policy.size() == 3 && output.col_policy.size() == 3);
+}
+
+int main()
+{
+    test_repeated_state();
+    test_action_count();
+    test_threaded_search();
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include <pinyon.hh>
+
+/*
+
+Check that EnsembleModel outputs the weighted average of its members, the same with and without a pool
+and for single and batched inference, that it rejects weights that do not fit its members,
+and that copies can be used by the threads of a search.
+
+*/
+
+using Neural = NeuralModel<HashRandomTree<>>;
+using Types = EnsembleModel<Neural>;
+
+static_assert(IsSingleModelTypes<Types> && IsBatchModelTypes<Types> && IsPolicyModelTypes<Types>);
+
+std::vector<Neural::Model> get_members()
+{
+    std::vector<Neural::Model> members{};
+    for (uint64_t seed = 0; seed < 3; ++seed)
+    {
+        prng device{seed};
+        auto network = std::make_shared<Neural::Network>(Neural::State::n_features, 32, 32, 4, 4);
+        network->randomize(device);
+        members.emplace_back(network);
+    }
+    return members;
+}
+
+void test_average()
+{
+    const std::vector<double> weights{1, 2, 5};
+    std::vector<Neural::Model> members = get_members();
+    const Neural::State state{prng{0}, 5, 3, 2, 2};
+
+    double value = 0;
+    std::vector<double> row_policy(3, 0);
+    for (size_t m = 0; m < members.size(); ++m)
+    {
+        Neural::ModelOutput output;
+        members[m].inference(Neural::State{state}, output);
+        value += weights[m] / 8 * output.value.get_row_value();
+        for (size_t i = 0; i < 3; ++i)
+        {
+            row_policy[i] += weights[m] / 8 * output.row_policy[i];
+        }
+    }
+
+    for (const size_t threads : {0, 3})
+    {
+        Types::Model model{members, weights, threads};
+        Types::ModelOutput output;
+        model.inference(Types::State{state}, output);
+        assert(std::abs(output.value.get_row_value() - value) < 1e-9);
+        assert(output.row_policy.size() == 3 && output.col_policy.size() == 2);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            assert(std::abs(output.row_policy[i] - row_policy[i]) < 1e-9);
+        }
+
+        Types::ModelBatchInput batch_input{};
+        Types::ModelBatchOutput batch_output{};
+        for (int i = 0; i < 4; ++i)
+        {
+            model.add_to_batch_input(Types::State{state}, batch_input);
+        }
+        model.inference(batch_input, batch_output);
+        assert(batch_output.size() == 4);
+        for (const auto &batch_entry : batch_output)
+        {
+            assert(std::abs(batch_entry.value.get_row_value() - value) < 1e-6);
+        }
+    }
+}
+
+void test_threaded_search()
+{
+    using MonteCarlo = MonteCarloModel<HashRandomTree<>>;
+    using SearchTypes = TreeBanditThreaded<Exp3<EnsembleModel<MonteCarlo>>>;
+    SearchTypes::Model model{{MonteCarlo::Model{prng{0}}, MonteCarlo::Model{prng{1}}}, {}, 2};
+    const SearchTypes::State state{prng{0}, 6, 2, 2, 2};
+    SearchTypes::Search search{SearchTypes::BanditAlgorithm{.1}, 3};
+    SearchTypes::MatrixNode root{};
+    prng device{0};
+    search.run_for_iterations(1 << 10, device, state, model, root);
+    assert(root.is_expanded());
+}
+
+void test_bad_weights()
+{
+    const auto throws = [](const std::vector<Neural::Model> &members, const std::vector<double> &weights)
+    {
+        try
+        {
+            Types::Model model{members, weights};
+        }
+        catch (const std::runtime_error &)
+        {
+            return true;
+        }
+        return false;
+    };
+    const std::vector<Neural::Model> members = get_members();
+    assert(throws({}, {}));
+    assert(throws(members, {1, 2}));
+    assert(throws(members, {0, 0, 0}));
+    assert(!throws(members, {0, 0, 1}));
+}
+
+int main()
+{
+    test_average();
+    test_bad_weights();
+    test_threaded_search();
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <pinyon.hh>
+
+/*
+
+Check that HashRandomTree is a chance state whose transition probabilities sum to 1,
+and that sampled transitions agree with the probabilities given for explicit chance actions.
+
+*/
+
+using Types = HashRandomTree<>;
+static_assert(IsChanceStateTypes<Types>);
+
+void test_chance_probs(const Types::State &state)
+{
+    if (state.is_terminal())
+    {
+        return;
+    }
+    for (int row_idx = 0; row_idx < state.rows; ++row_idx)
+    {
+        for (int col_idx = 0; col_idx < state.cols; ++col_idx)
+        {
+            std::vector<Types::Obs> chance_actions;
+            state.get_chance_actions(row_idx, col_idx, chance_actions);
+            assert(chance_actions.size() > 0);
+            double total = 0;
+            for (const auto chance_action : chance_actions)
+            {
+                Types::State child{state};
+                child.apply_actions(row_idx, col_idx, chance_action);
+                assert(child.get_prob() > 0);
+                total += child.get_prob();
+                test_chance_probs(child);
+            }
+            assert(std::abs(total - 1) < 1e-9);
+
+            // sampling picks one of the chance actions, with the same probability
+            for (uint64_t seed = 0; seed < 4; ++seed)
+            {
+                Types::State sampled{state}, explicit_{state};
+                sampled.randomize_transition(seed);
+                sampled.apply_actions(row_idx, col_idx);
+                assert(std::find(chance_actions.begin(), chance_actions.end(), sampled.get_obs()) != chance_actions.end());
+                explicit_.apply_actions(row_idx, col_idx, sampled.get_obs());
+                assert(sampled.get_prob() == explicit_.get_prob());
+                assert(sampled.path == explicit_.path && sampled.payoff_bias == explicit_.payoff_bias);
+            }
+        }
+    }
+}
+
+int main()
+{
+    for (uint64_t seed = 0; seed < 4; ++seed)
+    {
+        test_chance_probs(Types::State{prng{seed}, 3, 2, 3, 3});
+        test_chance_probs(Types::State{prng{seed}, 2, 3, 2, 4, Types::Q{1, 3}});
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <pinyon.hh>
+
+/*
+
+Check that the accumulator updated in apply_actions matches one computed from scratch,
+that the model agrees with the dense network on one-hot features, that it runs in a search,
+and that a network with the wrong number of inputs is rejected.
+
+*/
+
+using Types = IncrementalModel<HashRandomTree<>>;
+using Network = Types::Network;
+
+static_assert(IsSingleModelTypes<Types> && IsBatchModelTypes<Types> && IsPolicyModelTypes<Types>);
+static_assert(IsChanceStateTypes<Types>);
+
+std::shared_ptr<Network> get_network()
+{
+    prng device{0};
+    auto network = std::make_shared<Network>(Types::State::n_sparse_features, 64, 32, 4, 4);
+    network->randomize(device);
+    return network;
+}
+
+// the value of the full forward pass on the one-hot encoding of the active features
+double get_dense_value(const Network &network, const Types::State &state)
+{
+    std::vector<float> features(NeuralModelDetail::pad(network.inputs), 0);
+    std::vector<uint32_t> active{};
+    state.get_active_features(active);
+    for (const uint32_t feature : active)
+    {
+        features[feature] = 1;
+    }
+    NeuralModelDetail::Scratch scratch{};
+    NeuralModelDetail::forward<false>(network, features.data(), 1, scratch);
+    return 1 / (1 + std::exp(-scratch.value[0]));
+}
+
+void test_accumulator()
+{
+    const auto network = get_network();
+    Types::Model model{network};
+    prng device{0};
+    Types::ModelBatchInput batch_input{};
+    std::vector<Types::ModelOutput> single{};
+    for (uint64_t seed = 0; seed < 10; ++seed)
+    {
+        Types::State state = model.get_state(HashRandomTree<>::State{prng{seed}, 12, 3, 2, 2});
+        while (!state.is_terminal())
+        {
+            state.get_actions();
+            state.randomize_transition(device);
+            state.apply_actions(
+                state.row_actions[device.random_int(state.rows)],
+                state.col_actions[device.random_int(state.cols)]);
+
+            Types::State fresh{state};
+            fresh.refresh();
+            assert(state.active == fresh.active);
+            for (size_t o = 0; o < state.accumulator.size(); ++o)
+            {
+                assert(std::abs(state.accumulator[o] - fresh.accumulator[o]) < 1e-4);
+            }
+
+            Types::ModelOutput output;
+            model.inference(Types::State{state}, output);
+            assert(std::abs(output.value.get_row_value() - get_dense_value(*network, state)) < 1e-5);
+            assert(output.row_policy.size() == state.rows && output.col_policy.size() == state.cols);
+            model.add_to_batch_input(Types::State{state}, batch_input);
+            single.push_back(output);
+        }
+    }
+
+    Types::ModelBatchOutput batch_output{};
+    model.inference(batch_input, batch_output);
+    assert(batch_output.size() == single.size());
+    for (size_t i = 0; i < single.size(); ++i)
+    {
+        assert(batch_output[i].value.get_row_value() == single[i].value.get_row_value());
+    }
+}
+
+void test_search()
+{
+    using SearchTypes = TreeBandit<Exp3<Types>>;
+    SearchTypes::Model model{get_network()};
+    const SearchTypes::State state = model.get_state(HashRandomTree<>::State{prng{0}, 6, 2, 2, 2});
+    SearchTypes::Search search{SearchTypes::BanditAlgorithm{.1}};
+    SearchTypes::MatrixNode root{};
+    prng device{0};
+    search.run_for_iterations(1 << 10, device, state, model, root);
+    assert(root.is_expanded());
+}
+
+void test_inputs()
+{
+    bool threw = false;
+    try
+    {
+        Types::Model model{std::make_shared<Network>(Types::State::n_sparse_features / 2, 64, 32, 4, 4)};
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+}
+
+int main()
+{
+    test_accumulator();
+    test_search();
+    test_inputs();
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <pinyon.hh>
+
+/*
+
+Check that a threaded search can use a batched model through InferenceServer,
+that every request is answered once the threads outnumber the batch size,
+and that a submit wakes the server while a partial batch waits for its timeout.
+
+*/
+
+using BatchTypes = MonteCarloModel<HashRandomTree<>>;
+using Types = InferenceServer<BatchTypes>;
+
+static_assert(IsBatchModelTypes<BatchTypes>);
+static_assert(IsSingleModelTypes<Types>);
+
+void test_threaded_search()
+{
+    using SearchTypes = TreeBanditThreaded<Exp3<Types>>;
+    const size_t threads = 4;
+    // a full batch needs every thread, otherwise the timeout flushes it
+    Types::Model model{BatchTypes::Model{prng{0}}, threads, std::chrono::microseconds{100}};
+    const SearchTypes::State state{prng{0}, 6, 3, 3, 2};
+    SearchTypes::Search search{SearchTypes::BanditAlgorithm{.1}, threads};
+    SearchTypes::MatrixNode root{};
+    prng device{0};
+    const size_t iterations = 1 << 10;
+    search.run_for_iterations(iterations, device, state, model, root);
+
+    // at most one request per iteration, and each request was in exactly one batch
+    const size_t items = model.server->get_items();
+    assert(items > 0 && items <= iterations);
+    assert(model.server->get_batches() <= items);
+    assert(root.stats.visits > 0);
+}
+
+void test_submit()
+{
+    Types::Model model{BatchTypes::Model{prng{0}}, 8, std::chrono::microseconds{1000}};
+    std::vector<std::unique_ptr<Types::Request>> requests{};
+    for (int i = 0; i < 20; ++i)
+    {
+        requests.emplace_back(std::make_unique<Types::Request>(Types::State{prng{0}, 4, 2, 2, 1}));
+        model.submit(*requests.back());
+    }
+    for (auto &request : requests)
+    {
+        request->wait();
+        assert(request->is_done());
+        const double row_value = request->output.value.get_row_value();
+        assert(row_value == 0 || row_value == .5 || row_value == 1);
+    }
+    assert(model.server->get_items() == 20);
+    assert(model.server->get_batches() >= 3);
+}
+
+void test_wake()
+{
+    // the second request fills the batch, which is run long before the timeout
+    Types::Model model{BatchTypes::Model{prng{0}}, 2, std::chrono::seconds{10}};
+    const auto start = std::chrono::steady_clock::now();
+    Types::Request first{Types::State{prng{0}, 4, 2, 2, 1}};
+    model.submit(first);
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    assert(!first.is_done());
+    Types::Request second{Types::State{prng{1}, 4, 2, 2, 1}};
+    model.submit(second);
+    first.wait();
+    second.wait();
+    assert(std::chrono::steady_clock::now() - start < std::chrono::seconds{5});
+    assert(model.server->get_batches() == 1);
+}
+
+int main()
+{
+    test_threaded_search();
+    test_submit();
+    test_wake();
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <pinyon.hh>
+
+/*
+
+Check that the HashRandomTree lanes of LockstepModel make the same transitions as the state itself,
+that the model estimates the same values as MonteCarloModel, and that it works as the model of OffPolicy.
+
+*/
+
+using Types = LockstepModel<HashRandomTree<>>;
+using Lanes = LockstepModelDetail::Lanes<HashRandomTree<>>;
+
+static_assert(IsSingleModelTypes<Types> && IsBatchModelTypes<Types>);
+static_assert(Lanes::enabled && !LockstepModelDetail::Lanes<RandomTree<>>::enabled);
+
+void test_splitmix()
+{
+    std::vector<uint64_t> x(64);
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        x[i] = i * 0x123456789abcdef;
+    }
+    std::vector<uint64_t> y{x};
+    LockstepModelDetail::splitmix64(y.data(), y.size());
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        assert(y[i] == math::splitmix64(x[i]));
+    }
+}
+
+void test_lanes()
+{
+    std::vector<Types::State> states{};
+    for (uint64_t seed = 0; seed < 13; ++seed)
+    {
+        states.emplace_back(prng{seed}, 10, 2 + seed % 3, 3, 1 + seed % 4, Rational<>{1, 5});
+    }
+    Lanes lanes{};
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        lanes.push(states[i], i + 100, i);
+    }
+    for (size_t step = 0; step < 10; ++step)
+    {
+        lanes.step(step);
+        for (size_t i = 0; i < states.size(); ++i)
+        {
+            Types::State &state = states[i];
+            int row_idx, col_idx;
+            uint64_t transition_seed;
+            LockstepModelDetail::get_step(i + 100, step, state.rows, state.cols, row_idx, col_idx, transition_seed);
+            state.randomize_transition(transition_seed);
+            state.apply_actions(row_idx, col_idx);
+            assert(lanes.path[i] == state.path);
+            assert(lanes.payoff_bias[i] == state.payoff_bias);
+            assert(lanes.is_terminal(i) == state.is_terminal());
+        }
+    }
+}
+
+double get_mean(auto &model, const Types::State &state, const size_t batch_size)
+{
+    Types::ModelBatchInput batch_input(batch_size, state);
+    Types::ModelBatchOutput batch_output{};
+    model.inference(batch_input, batch_output);
+    double total = 0;
+    for (const auto &output : batch_output)
+    {
+        total += output.value.get_row_value();
+    }
+    return total / batch_size;
+}
+
+void test_values()
+{
+    const Types::State state{prng{0}, 8, 3, 3, 3};
+    MonteCarloModel<HashRandomTree<>>::Model scalar{prng{0}};
+    Types::Model lockstep{prng{0}};
+    assert(std::abs(get_mean(scalar, state, 1 << 12) - get_mean(lockstep, state, 1 << 12)) < .05);
+
+    // cut off after one step, every value is a heuristic value
+    Types::Model truncated{prng{0}, Types::Options{.rollouts = 2, .max_depth = 1}};
+    Types::ModelBatchInput batch_input(16, state);
+    Types::ModelBatchOutput batch_output{};
+    truncated.inference(batch_input, batch_output);
+    for (const auto &output : batch_output)
+    {
+        const double value = output.value.get_row_value();
+        assert(value * 4 == std::round(value * 4));
+    }
+
+    using Mold = LockstepModel<MoldState<>, true>;
+    Mold::Model mold{prng{0}};
+    Mold::ModelBatchInput mold_input(5, Mold::State{3, 4});
+    Mold::ModelBatchOutput mold_output{};
+    mold.inference(mold_input, mold_output);
+    assert(mold_output.size() == 5 && mold_output[0].row_policy.size() == 3);
+}
+
+void test_off_policy()
+{
+    using SearchTypes = OffPolicy<Exp3<Types>>;
+    const std::vector<SearchTypes::State> states(8, SearchTypes::State{prng{0}, 6, 2, 2, 2});
+    std::vector<SearchTypes::MatrixNode> nodes(states.size());
+    SearchTypes::Model model{prng{0}};
+    SearchTypes::Search search{SearchTypes::BanditAlgorithm{.1}};
+    prng device{0};
+    search.run_for_iterations(1 << 6, 1 << 3, device, states, model, nodes);
+    for (const auto &node : nodes)
+    {
+        assert(node.is_expanded());
+    }
+}
+
+int main()
+{
+    test_splitmix();
+    test_lanes();
+    test_values();
+    test_off_policy();
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <pinyon.hh>
+
+/*
+
+Check that MatrixUCBIncremental builds the same UCB matrix as MatrixUCB from the same updates,
+and that when it checks and solves at every visit, its search is the same as MatrixUCB's.
+
+*/
+
+using Types = MonteCarloModel<HashRandomTree<>>;
+using MatrixUCBTypes = MatrixUCB<Types>;
+using IncrementalTypes = MatrixUCBIncremental<Types>;
+
+static_assert(IsBanditAlgorithmTypes<MatrixUCBTypes> && IsBanditAlgorithmTypes<IncrementalTypes>);
+
+void test_ucb_matrix()
+{
+    const size_t rows = 3, cols = 4;
+    MatrixUCBTypes::BanditAlgorithm ucb{};
+    IncrementalTypes::BanditAlgorithm incremental{};
+    MatrixUCBTypes::MatrixStats ucb_stats{};
+    IncrementalTypes::MatrixStats incremental_stats{};
+    ucb.expand(ucb_stats, rows, cols, {});
+    incremental.expand(incremental_stats, rows, cols, {});
+
+    prng device{0};
+    MatrixUCBTypes::MatrixPairReal ucb_matrix{rows, cols}, incremental_matrix{rows, cols};
+    for (int t = 0; t < 200; ++t)
+    {
+        MatrixUCBTypes::Outcome ucb_outcome{};
+        IncrementalTypes::Outcome incremental_outcome{};
+        ucb_outcome.row_idx = incremental_outcome.row_idx = device.random_int(rows);
+        ucb_outcome.col_idx = incremental_outcome.col_idx = device.random_int(cols);
+        ucb_outcome.value = incremental_outcome.value = Types::Value{Types::Real{device.uniform()}};
+        ucb.update_matrix_stats(ucb_stats, ucb_outcome);
+        incremental.update_matrix_stats(incremental_stats, incremental_outcome);
+
+        ucb.get_ucb_matrix(ucb_stats, ucb_matrix);
+        incremental.get_ucb_matrix(incremental_stats, incremental_matrix);
+        for (size_t i = 0; i < rows * cols; ++i)
+        {
+            assert(std::abs(ucb_matrix[i].get_row_value() - incremental_matrix[i].get_row_value()) < 1e-12);
+            assert(std::abs(ucb_matrix[i].get_col_value() - incremental_matrix[i].get_col_value()) < 1e-12);
+        }
+    }
+}
+
+void test_search()
+{
+    const Types::State state{prng{0}, 5, 3, 3, 2};
+    const size_t iterations = 1 << 10;
+
+    TreeBandit<MatrixUCBTypes>::Search ucb_search{MatrixUCBTypes::BanditAlgorithm{2, .005}};
+    TreeBandit<MatrixUCBTypes>::MatrixNode ucb_root{};
+    prng ucb_device{0};
+    Types::Model ucb_model{prng{0}};
+    ucb_search.run_for_iterations(iterations, ucb_device, state, ucb_model, ucb_root);
+
+    TreeBandit<IncrementalTypes>::Search incremental_search{IncrementalTypes::BanditAlgorithm{2, .005, 1, 0}};
+    TreeBandit<IncrementalTypes>::MatrixNode incremental_root{};
+    prng incremental_device{0};
+    Types::Model incremental_model{prng{0}};
+    incremental_search.run_for_iterations(iterations, incremental_device, state, incremental_model, incremental_root);
+
+    const auto &ucb_data = ucb_root.stats.data_matrix;
+    const auto &incremental_data = incremental_root.stats.data_matrix;
+    assert(ucb_root.stats.total_visits == incremental_root.stats.total_visits);
+    assert(ucb_data.size() == incremental_data.size());
+    for (size_t i = 0; i < ucb_data.size(); ++i)
+    {
+        assert(ucb_data[i].visits == incremental_data[i].visits);
+    }
+    assert(ucb_root.count_matrix_nodes() == incremental_root.count_matrix_nodes());
+
+    Types::Value ucb_value, incremental_value;
+    ucb_search.get_empirical_value(ucb_root.stats, ucb_value);
+    incremental_search.get_empirical_value(incremental_root.stats, incremental_value);
+    assert(std::abs(ucb_value.get_row_value() - incremental_value.get_row_value()) < 1e-9);
+}
+
+int main()
+{
+    test_ucb_matrix();
+    test_search();
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include <pinyon.hh>
+
+/*
+
+Check the MonteCarloModel options: the rollout policy is called once per step of every playout,
+playouts stop at max_depth, and averaging several playouts lowers the variance of the value.
+Interleaved batches give the same values with any number of threads, since each thread has its own scratch,
+and interleaving works with states that can be copied but not assigned.
+
+*/
+
+// always plays the first actions, and counts how often it is asked
+struct CountingPolicy
+{
+    std::shared_ptr<std::atomic<size_t>> calls = std::make_shared<std::atomic<size_t>>(0);
+
+    template <typename PRNG, typename State>
+    void sample(PRNG &device, const State &state, int &row_idx, int &col_idx) const
+    {
+        calls->fetch_add(1);
+        row_idx = 0;
+        col_idx = 0;
+    }
+};
+
+using Types = MonteCarloModel<HashRandomTree<>, false, CountingPolicy>;
+
+static_assert(IsSingleModelTypes<Types> && IsBatchModelTypes<Types>);
+static_assert(IsHeuristicStateTypes<Types>);
+
+void test_options()
+{
+    const Types::State state{prng{0}, 10, 3, 3, 2};
+    for (const bool interleave : {false, true})
+    {
+        CountingPolicy policy{};
+        Types::Model model{prng{0}, Types::Options{.rollouts = 4, .interleave = interleave}, policy};
+        Types::ModelOutput output;
+        model.inference(Types::State{state}, output);
+        assert(policy.calls->load() == 4 * 10);
+
+        policy.calls->store(0);
+        model.options.max_depth = 3;
+        model.inference(Types::State{state}, output);
+        assert(policy.calls->load() == 4 * 3);
+        // an average of 4 heuristic values, each 0, 1/2 or 1
+        const double value = output.value.get_row_value();
+        assert(value >= 0 && value <= 1 && value * 8 == std::round(value * 8));
+    }
+}
+
+double get_variance(const size_t rollouts)
+{
+    using Uniform = MonteCarloModel<HashRandomTree<>>;
+    Uniform::Model model{prng{0}, Uniform::Options{.rollouts = rollouts}};
+    const size_t trials = 200;
+    double sum = 0, sum_squares = 0;
+    for (size_t t = 0; t < trials; ++t)
+    {
+        Uniform::ModelOutput output;
+        model.inference(Uniform::State{prng{0}, 8, 3, 3, 3}, output);
+        const double value = output.value.get_row_value();
+        sum += value;
+        sum_squares += value * value;
+    }
+    const double mean = sum / trials;
+    return sum_squares / trials - mean * mean;
+}
+
+void test_variance()
+{
+    const double one = get_variance(1);
+    const double eight = get_variance(8);
+    assert(one > 0);
+    assert(eight < one / 2);
+}
+
+void test_interleave_batch()
+{
+    using Uniform = MonteCarloModel<HashRandomTree<>>;
+    const Uniform::Options options{.rollouts = 4, .interleave = true};
+    std::vector<Uniform::ModelOutput> expected;
+    for (const size_t threads : {0, 1, 3})
+    {
+        Uniform::Model model{prng{0}, options, {}, threads};
+        for (int call = 0; call < 3; ++call)
+        {
+            Uniform::ModelBatchInput input{};
+            for (uint64_t i = 0; i < 10; ++i)
+            {
+                model.add_to_batch_input(Uniform::State{prng{i}, 6, 3, 3, 2}, input);
+            }
+            Uniform::ModelBatchOutput output{};
+            model.inference(input, output);
+            assert(output.size() == 10);
+            if (threads == 0)
+            {
+                expected.insert(expected.end(), output.begin(), output.end());
+                continue;
+            }
+            for (size_t i = 0; i < 10; ++i)
+            {
+                assert(output[i].value.get_row_value() == expected[10 * call + i].value.get_row_value());
+            }
+        }
+    }
+}
+
+// a const member deletes the assignment operators, like ModelBandit
+struct ConstTree : HashRandomTree<>
+{
+    class State : public HashRandomTree<>::State
+    {
+    public:
+        const size_t id;
+
+        State(const HashRandomTree<>::State &state, const size_t id) : HashRandomTree<>::State{state}, id{id} {}
+    };
+};
+
+void test_interleave_non_assignable()
+{
+    using Const = MonteCarloModel<ConstTree>;
+    static_assert(!std::is_copy_assignable_v<Const::State>);
+    const HashRandomTree<>::State base{prng{0}, 8, 3, 3, 2};
+    Const::Model model{prng{0}, Const::Options{.rollouts = 5, .interleave = true}};
+    for (int call = 0; call < 2; ++call)
+    {
+        Const::ModelOutput output;
+        model.inference(Const::State{base, 1}, output);
+        const double value = output.value.get_row_value();
+        assert(value >= 0 && value <= 1);
+    }
+}
+
+int main()
+{
+    test_options();
+    test_variance();
+    test_interleave_batch();
+    test_interleave_non_assignable();
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <pinyon.hh>
+
+/*
+
+Check that every iteration of TreeBanditFlatThreaded reaches the root stats, with several threads
+and after the node capacity is used up.
+As in the other searches, the first iteration on an empty tree only expands the root.
+
+*/
+
+using Types = TreeBanditFlatThreaded<Exp3<MonteCarloModel<MoldState<>>>>;
+
+int root_visits(const Types::Search &search)
+{
+    const auto &stats = search.matrix_data[0].stats;
+    int row_visits = 0, col_visits = 0;
+    for (const auto n : stats.row_visits)
+    {
+        row_visits += n;
+    }
+    for (const auto n : stats.col_visits)
+    {
+        col_visits += n;
+    }
+    assert(row_visits == stats.visits && col_visits == stats.visits);
+    return stats.visits;
+}
+
+void test_visits()
+{
+    const Types::State state{3, 5};
+    const size_t iterations = 1 << 12;
+    for (const size_t threads : {1, 2, 4})
+    {
+        Types::Search search{Types::BanditAlgorithm{.01}, threads};
+        Types::Model model{prng{0}};
+        prng device{0};
+        search.run_for_iterations(iterations, device, state, model);
+        assert(root_visits(search) == iterations - 1);
+        assert(search.get_size() > 1 && search.get_size() <= iterations);
+    }
+}
+
+void test_max_nodes()
+{
+    const Types::State state{3, 5};
+    const size_t iterations = 1 << 12;
+    const size_t max_nodes = 1 << 6;
+    for (const size_t threads : {1, 4})
+    {
+        Types::Search search{Types::BanditAlgorithm{.01}, threads, max_nodes};
+        Types::Model model{prng{0}};
+        prng device{0};
+        search.run_for_iterations(iterations, device, state, model);
+
+        // leaves past the capacity are still evaluated and backpropagated
+        assert(search.get_size() == max_nodes);
+        assert(root_visits(search) == iterations - 1);
+        size_t expanded = 0;
+        for (size_t i = 0; i < max_nodes; ++i)
+        {
+            expanded += search.matrix_data[i].expanded.load();
+        }
+        assert(expanded == max_nodes);
+
+        // the full tree can still be searched
+        search.run_for_iterations(iterations, device, state, model);
+        assert(search.get_size() == max_nodes);
+        assert(root_visits(search) == 2 * iterations - 1);
+
+        search.clear();
+        assert(search.get_size() == 1 && !search.matrix_data[0].expanded.load());
+        search.run_for_iterations(iterations, device, state, model);
+        assert(root_visits(search) == iterations - 1);
+    }
+}
+
+int main()
+{
+    test_visits();
+    test_max_nodes();
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include <pinyon.hh>
+
+/*
+
+Check the NeuralModel kernels against each other, the weights file round trip,
+that single and batched inference agree, that the int8 network stays close to the float one,
+and that networks which do not fit the state are rejected.
+
+*/
+
+using Types = NeuralModel<HashRandomTree<>>;
+using QuantizedTypes = NeuralModel<HashRandomTree<>, true>;
+using Network = Types::Network;
+
+static_assert(IsSingleModelTypes<Types> && IsBatchModelTypes<Types> && IsPolicyModelTypes<Types>);
+static_assert(IsSingleModelTypes<QuantizedTypes> && IsBatchModelTypes<QuantizedTypes>);
+
+void test_kernels()
+{
+    prng device{0};
+    const size_t n = 96;
+    std::vector<float> a(n), b(n);
+    std::vector<uint8_t> a_q(n);
+    std::vector<int8_t> b_q(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i] = device.uniform() - .5;
+        b[i] = device.uniform() - .5;
+        a_q[i] = device.random_int(128);
+        b_q[i] = device.random_int(256) - 128;
+    }
+    const float dot = NeuralModelDetail::dot_scalar(a.data(), b.data(), n);
+    assert(std::abs(NeuralModelDetail::dot(a.data(), b.data(), n) - dot) < 1e-4);
+    assert(NeuralModelDetail::dot_int8(a_q.data(), b_q.data(), n) ==
+           NeuralModelDetail::dot_int8_scalar(a_q.data(), b_q.data(), n));
+}
+
+template <typename ModelTypes>
+void get_outputs(typename ModelTypes::Model &model, const std::vector<Types::State> &states,
+                 std::vector<typename ModelTypes::ModelOutput> &single, typename ModelTypes::ModelBatchOutput &batch)
+{
+    typename ModelTypes::ModelBatchInput batch_input{};
+    single.resize(states.size());
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        model.inference(typename ModelTypes::State{states[i]}, single[i]);
+        model.add_to_batch_input(typename ModelTypes::State{states[i]}, batch_input);
+    }
+    model.inference(batch_input, batch);
+}
+
+void test_model()
+{
+    prng device{0};
+    auto network = std::make_shared<Network>(Types::State::n_features, 64, 32, 4, 4);
+    network->randomize(device);
+    const std::string path = "neural-model-test.bin";
+    network->save(path);
+    Types::Model loaded{path};
+    std::remove(path.c_str());
+    Types::Model model{network};
+    QuantizedTypes::Model quantized_model{network};
+
+    std::vector<Types::State> states{};
+    for (uint64_t seed = 0; seed < 20; ++seed)
+    {
+        states.emplace_back(prng{seed}, 5, 2 + seed % 3, 4 - seed % 3, 2);
+    }
+
+    std::vector<Types::ModelOutput> single, loaded_single;
+    std::vector<QuantizedTypes::ModelOutput> quantized_single;
+    Types::ModelBatchOutput batch, loaded_batch;
+    QuantizedTypes::ModelBatchOutput quantized_batch;
+    get_outputs<Types>(model, states, single, batch);
+    get_outputs<Types>(loaded, states, loaded_single, loaded_batch);
+    get_outputs<QuantizedTypes>(quantized_model, states, quantized_single, quantized_batch);
+
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        const double value = single[i].value.get_row_value();
+        assert(value == batch[i].value.get_row_value());
+        assert(value == loaded_single[i].value.get_row_value());
+        assert(std::abs(value - quantized_single[i].value.get_row_value()) < .05);
+        assert(quantized_single[i].value.get_row_value() == quantized_batch[i].value.get_row_value());
+
+        assert(single[i].row_policy.size() == states[i].row_actions.size());
+        assert(single[i].col_policy.size() == states[i].col_actions.size());
+        double row_sum = 0;
+        for (size_t j = 0; j < single[i].row_policy.size(); ++j)
+        {
+            row_sum += single[i].row_policy[j];
+            assert(single[i].row_policy[j] == batch[i].row_policy[j]);
+            assert(std::abs(single[i].row_policy[j] - quantized_single[i].row_policy[j]) < .05);
+        }
+        assert(std::abs(row_sum - 1) < 1e-6);
+    }
+
+    bool threw = false;
+    try
+    {
+        Types::Model missing{std::string{"missing-weights.bin"}};
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+}
+
+template <typename F>
+bool throws(F &&f)
+{
+    try
+    {
+        f();
+    }
+    catch (const std::runtime_error &)
+    {
+        return true;
+    }
+    return false;
+}
+
+void test_checks()
+{
+    prng device{0};
+    auto narrow = std::make_shared<Network>(Types::State::n_features - 8, 32, 32, 4, 4);
+    assert(throws([&]
+                  { Types::Model model{narrow}; }));
+
+    // the state has 5 row actions but the network only 4
+    auto network = std::make_shared<Network>(Types::State::n_features, 32, 32, 4, 4);
+    network->randomize(device);
+    Types::Model model{network};
+    Types::ModelOutput output{};
+    assert(throws([&]
+                  { model.inference(Types::State{prng{0}, 5, 5, 2, 2}, output); }));
+    Types::ModelBatchInput batch_input{};
+    Types::ModelBatchOutput batch_output{};
+    model.add_to_batch_input(Types::State{prng{0}, 5, 2, 5, 2}, batch_input);
+    assert(throws([&]
+                  { model.inference(batch_input, batch_output); }));
+}
+
+int main()
+{
+    test_kernels();
+    test_model();
+    test_checks();
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include <pinyon.hh>
+
+/*
+
+Check that the pipelined OffPolicy search gives every root all of its iterations,
+whether or not the roots divide evenly among the actor threads.
+
+*/
+
+using Types = OffPolicy<Exp3<MonteCarloModel<MoldState<>>>>;
+
+void test_root_visits()
+{
+    const size_t learner_iterations = 1 << 5;
+    const size_t actor_iterations_per = 1 << 3;
+    const std::vector<Types::State> states(7, Types::State{3, 4});
+    for (const size_t threads : {1, 2, 3})
+    {
+        std::vector<Types::MatrixNode> nodes(states.size());
+        Types::Model model{prng{0}};
+        Types::Search search{Types::BanditAlgorithm{.1}, threads};
+        prng device{0};
+        search.run_for_iterations(learner_iterations, actor_iterations_per, device, states, model, nodes);
+        for (const auto &node : nodes)
+        {
+            assert(node.is_expanded() && node.stats.properly_expanded);
+            // the first trajectory through a root only expands it
+            assert(node.stats.visits == learner_iterations * actor_iterations_per - 1);
+        }
+    }
+}
+
+int main()
+{
+    test_root_visits();
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <pinyon.hh>
+
+#include <sstream>
+
+/*
+
+Check that PackedBatchOutput survives a round trip through a stream of blocks within its quantization error,
+that PackedModel gives the outputs of the model it wraps, and that OffPolicy can use it.
+
+*/
+
+using Neural = NeuralModel<HashRandomTree<>>;
+using Types = PackedModel<Neural>;
+
+static_assert(IsBatchModelTypes<Types> && IsPolicyModelTypes<Types>);
+
+template <typename Q, typename OutputTypes>
+void test_round_trip()
+{
+    using Packed = PackedBatchOutput<OutputTypes, Q>;
+    const double tolerance = 4.0 / std::numeric_limits<Q>::max();
+    prng device{0};
+    std::vector<typename OutputTypes::ModelOutput> outputs(50);
+    for (auto &output : outputs)
+    {
+        const double v = device.uniform();
+        if constexpr (OutputTypes::Value::IS_CONSTANT_SUM)
+        {
+            output.value = typename OutputTypes::Value{typename OutputTypes::Real{v}};
+        }
+        else
+        {
+            output.value = typename OutputTypes::Value{typename OutputTypes::Real{v}, typename OutputTypes::Real{1 - v}};
+        }
+        for (auto *policy : {&output.row_policy, &output.col_policy})
+        {
+            policy->resize(1 + device.random_int(6));
+            double sum = 0;
+            for (auto &p : *policy)
+            {
+                p = device.uniform();
+                sum += p;
+            }
+            for (auto &p : *policy)
+            {
+                p /= sum;
+            }
+        }
+    }
+
+    std::stringstream stream{};
+    Packed packed{};
+    for (size_t block = 0; block < 2; ++block)
+    {
+        packed.clear();
+        for (size_t i = block * 25; i < (block + 1) * 25; ++i)
+        {
+            packed.push(outputs[i]);
+        }
+        packed.write(stream);
+    }
+
+    Packed read{};
+    typename OutputTypes::ModelOutput output{};
+    size_t index = 0;
+    while (read.read(stream))
+    {
+        for (size_t i = 0; i < read.size(); ++i, ++index)
+        {
+            read.get(i, output);
+            assert(std::abs(output.value.get_row_value() - outputs[index].value.get_row_value()) < 1e-6);
+            assert(std::abs(output.value.get_col_value() - outputs[index].value.get_col_value()) < 1e-6);
+            assert(output.row_policy.size() == outputs[index].row_policy.size());
+            assert(output.col_policy.size() == outputs[index].col_policy.size());
+            for (size_t j = 0; j < output.row_policy.size(); ++j)
+            {
+                assert(std::abs(output.row_policy[j] - outputs[index].row_policy[j]) < tolerance);
+            }
+        }
+    }
+    assert(index == outputs.size());
+
+    std::stringstream bad{"not a block of outputs"};
+    bool threw = false;
+    try
+    {
+        read.read(bad);
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_model()
+{
+    prng device{0};
+    auto network = std::make_shared<Neural::Network>(Neural::State::n_features, 32, 32, 4, 4);
+    network->randomize(device);
+    Neural::Model neural{network};
+    Types::Model packed{neural};
+
+    // the generic path, packing the wrapped model's batch output
+    using MonteCarlo = MonteCarloModel<HashRandomTree<>, true>;
+    PackedModel<MonteCarlo>::Model packed_monte_carlo{MonteCarlo::Model{prng{0}}};
+    PackedModel<MonteCarlo>::ModelBatchInput monte_carlo_input{};
+    PackedModel<MonteCarlo>::ModelBatchOutput monte_carlo_output{};
+
+    Neural::ModelBatchInput neural_input{}, packed_input{};
+    for (uint64_t seed = 0; seed < 10; ++seed)
+    {
+        const Neural::State state{prng{seed}, 5, 2 + seed % 3, 3, 2};
+        neural.add_to_batch_input(Neural::State{state}, neural_input);
+        packed.add_to_batch_input(Neural::State{state}, packed_input);
+        packed_monte_carlo.add_to_batch_input(MonteCarlo::State{state}, monte_carlo_input);
+    }
+    Neural::ModelBatchOutput neural_output{};
+    Types::ModelBatchOutput packed_output{};
+    neural.inference(neural_input, neural_output);
+    packed.inference(packed_input, packed_output);
+    packed_monte_carlo.inference(monte_carlo_input, monte_carlo_output);
+    assert(packed_output.size() == 10 && monte_carlo_output.size() == 10);
+
+    Types::ModelOutput output{};
+    for (size_t i = 0; i < 10; ++i)
+    {
+        packed.get_output(output, packed_output, i);
+        assert(std::abs(output.value.get_row_value() - neural_output[i].value.get_row_value()) < 1e-6);
+        for (size_t j = 0; j < output.row_policy.size(); ++j)
+        {
+            assert(std::abs(output.row_policy[j] - neural_output[i].row_policy[j]) < 1e-3);
+        }
+    }
+    // vectors of ModelOutput cost at least two vectors per item on top of the policies
+    assert(packed_output.get_bytes() < neural_output.size() * sizeof(Neural::ModelOutput));
+
+    using SearchTypes = OffPolicy<Exp3<Types>>;
+    const std::vector<SearchTypes::State> states(4, SearchTypes::State{prng{0}, 6, 2, 2, 2});
+    std::vector<SearchTypes::MatrixNode> nodes(states.size());
+    SearchTypes::Search search{SearchTypes::BanditAlgorithm{.1}};
+    search.run_for_iterations(1 << 5, 1 << 3, device, states, packed, nodes);
+    for (const auto &node : nodes)
+    {
+        assert(node.is_expanded());
+    }
+}
+
+int main()
+{
+    test_round_trip<uint8_t, Neural>();
+    test_round_trip<uint16_t, Neural>();
+    test_round_trip<uint16_t, MonteCarloModel<MoldState<>, true>>();
+    test_model();
+    return 0;
+}
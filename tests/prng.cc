@@ -0,0 +1,113 @@
+#include <pinyon.hh>
+
+/*
+
+Check that philox satisfies IsPRNG, that discard matches stepping the generator,
+and that it can replace prng in the shipped type lists.
+
+*/
+
+static_assert(IsPRNG<philox, uint64_t>);
+
+using PhiloxTypes = DefaultTypes<
+    double,
+    int,
+    int,
+    double,
+    ConstantSum<1, 1>::Value,
+    std::vector,
+    Matrix,
+    std::mutex,
+    uint64_t,
+    philox>;
+
+static_assert(IsTypeList<PhiloxTypes>);
+
+void test_discard()
+{
+    for (size_t offset = 0; offset < 3; ++offset)
+    {
+        for (size_t n = 0; n < 7; ++n)
+        {
+            philox stepped{1}, skipped{1};
+            for (size_t i = 0; i < offset; ++i)
+            {
+                stepped.uniform_64();
+                skipped.uniform_64();
+            }
+            for (size_t i = 0; i < n; ++i)
+            {
+                stepped.uniform_64();
+            }
+            skipped.discard(n);
+            assert(stepped.uniform_64() == skipped.uniform_64());
+            assert(stepped.uniform_64() == skipped.uniform_64());
+        }
+    }
+}
+
+void test_streams()
+{
+    philox a{1}, b{1}, c{1, 1};
+    assert(a.get_seed() == 1);
+    for (size_t i = 0; i < 16; ++i)
+    {
+        const uint64_t x = a.uniform_64();
+        assert(x == b.uniform_64());
+        assert(x != c.uniform_64());
+    }
+}
+
+void test_distribution()
+{
+    philox device{0};
+    const size_t n = 1 << 16;
+    double sum = 0;
+    size_t counts[5]{};
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double x = device.uniform();
+        assert(x > 0 && x < 1);
+        sum += x;
+        const int k = device.random_int(5);
+        assert(k >= 0 && k < 5);
+        ++counts[k];
+    }
+    assert(std::abs(sum / n - .5) < .01);
+    for (size_t k = 0; k < 5; ++k)
+    {
+        assert(std::abs(static_cast<double>(counts[k]) / n - .2) < .01);
+    }
+
+    const std::vector<double> pdf{.1, .0, .9};
+    size_t first = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const int k = device.sample_pdf(pdf);
+        assert(k != 1);
+        first += (k == 0);
+    }
+    assert(std::abs(static_cast<double>(first) / n - .1) < .01);
+}
+
+void test_search()
+{
+    using Types = TreeBandit<Exp3<MonteCarloModel<RandomTree<PhiloxTypes>>>>;
+    Types::PRNG device{0};
+    Types::State state{Types::PRNG{1}, 3, 3, 3, 2};
+    Types::Model model{0};
+    Types::MatrixNode root{};
+    Types::Search search{};
+    search.run_for_iterations(1 << 10, device, state, model, root);
+    assert(root.count_matrix_nodes() > 1);
+}
+
+int main()
+{
+    test_discard();
+    test_streams();
+    test_distribution();
+    test_search();
+    std::cout << "sizeof(prng): " << sizeof(prng) << ", sizeof(philox): " << sizeof(philox) << std::endl;
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <pinyon.hh>
+
+/*
+
+Check that PUCT selection follows the priors from the model policy, and that the threaded search
+updates it through the mutex overloads.
+
+*/
+
+using Types = PUCT<MonteCarloModel<MoldState<>, true>>;
+
+static_assert(IsMultithreadedBanditTypes<Types>);
+
+void test_priors()
+{
+    Types::BanditAlgorithm bandit{};
+    Types::ModelOutput output{};
+    output.row_policy = {.1, .6, .3};
+    // one more entry than there are columns, the extra is ignored
+    output.col_policy = {.5, .3, .2, .1};
+    Types::MatrixStats stats{};
+    bandit.expand(stats, 3, 3, output);
+    assert(stats.row_priors.size() == 3 && stats.col_priors.size() == 3);
+    assert(stats.row_priors[1] == .6f && stats.col_priors[0] == .5f);
+
+    // the first selection already follows the priors
+    prng device{0};
+    {
+        Types::Outcome outcome{};
+        bandit.select(device, stats, outcome);
+        assert(outcome.row_idx == 1 && outcome.col_idx == 0);
+    }
+
+    // with equal payoffs the visits are in proportion to the priors
+    const size_t n = 1 << 12;
+    for (size_t i = 0; i < n; ++i)
+    {
+        Types::Outcome outcome{};
+        bandit.select(device, stats, outcome);
+        outcome.value = Types::Value{.5, .5};
+        bandit.update_matrix_stats(stats, outcome);
+    }
+    for (size_t i = 0; i < 3; ++i)
+    {
+        assert(std::abs(stats.row_visits[i] / n - output.row_policy[i]) < .01);
+    }
+    assert(stats.col_visits[0] > stats.col_visits[1] && stats.col_visits[1] > stats.col_visits[2]);
+
+    // the locked select is the same as the unlocked one
+    Types::Mutex mutex{};
+    Types::Outcome outcome{}, locked_outcome{};
+    bandit.select(device, stats, outcome);
+    bandit.select(device, stats, locked_outcome, mutex);
+    assert(outcome.row_idx == locked_outcome.row_idx && outcome.col_idx == locked_outcome.col_idx);
+}
+
+void test_short_policy()
+{
+    Types::BanditAlgorithm bandit{};
+    Types::ModelOutput output{};
+    output.row_policy = {1};
+    Types::MatrixStats stats{};
+    bandit.expand(stats, 2, 4, output);
+    assert(stats.row_priors.size() == 2 && stats.col_priors.size() == 4);
+    assert(stats.row_priors[0] == .5f && stats.row_priors[1] == .5f);
+    assert(stats.col_priors[3] == .25f);
+}
+
+std::atomic<size_t> locked_updates{0};
+std::atomic<size_t> unlocked_updates{0};
+
+// counts which update overload the search calls
+struct CountingPUCT : Types
+{
+    class BanditAlgorithm : public Types::BanditAlgorithm
+    {
+    public:
+        using Types::BanditAlgorithm::BanditAlgorithm;
+
+        void update_matrix_stats(MatrixStats &stats, const Outcome &outcome) const
+        {
+            ++unlocked_updates;
+            Types::BanditAlgorithm::update_matrix_stats(stats, outcome);
+        }
+
+        void update_matrix_stats(MatrixStats &stats, const Outcome &outcome, Types::Mutex &mutex) const
+        {
+            ++locked_updates;
+            Types::BanditAlgorithm::update_matrix_stats(stats, outcome, mutex);
+        }
+    };
+};
+
+void test_threaded()
+{
+    using SearchTypes = TreeBanditThreaded<CountingPUCT>;
+    const SearchTypes::State state{3, 3};
+    const size_t iterations = 1 << 10;
+    SearchTypes::Search search{SearchTypes::BanditAlgorithm{}, 2};
+    SearchTypes::Model model{prng{0}};
+    SearchTypes::MatrixNode root{};
+    prng device{0};
+    search.run_for_iterations(iterations, device, state, model, root);
+
+    // the first iteration only expands the root
+    assert(root.stats.visits == iterations - 1);
+    assert(locked_updates >= iterations - 1);
+    assert(unlocked_updates == 0);
+}
+
+int main()
+{
+    test_priors();
+    test_short_policy();
+    test_threaded();
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <pinyon.hh>
+
+/*
+
+Check that RMPlus converges on a small matrix game with a known mixed equilibrium.
+In the game below each player's equilibrium strategy is (1/3, 2/3) and the value is 1/3.
+
+*/
+
+template <bool average>
+void test_convergence()
+{
+    using Types = RMPlus<MonteCarloModel<MoldState<RandomTreeFloatTypes>>, average>;
+    const double payoffs[2][2] = {{1, 0}, {0, .5}};
+
+    typename Types::BanditAlgorithm bandit{.05};
+    typename Types::MatrixStats stats{};
+    bandit.expand(stats, 2, 2, {});
+    prng device{0};
+    for (int t = 0; t < 1 << 18; ++t)
+    {
+        typename Types::Outcome outcome{};
+        bandit.select(device, stats, outcome);
+        outcome.value = typename Types::Value{typename Types::Real{payoffs[outcome.row_idx][outcome.col_idx]}};
+        bandit.update_matrix_stats(stats, outcome);
+    }
+
+    typename Types::VectorReal row_strategy, col_strategy;
+    bandit.get_empirical_strategies(stats, row_strategy, col_strategy);
+    assert(std::abs(row_strategy[0] - 1.0 / 3) < .05);
+    assert(std::abs(col_strategy[0] - 1.0 / 3) < .05);
+
+    typename Types::MatrixValue payoff_matrix{2, 2};
+    for (int i = 0; i < 2; ++i)
+    {
+        for (int j = 0; j < 2; ++j)
+        {
+            payoff_matrix.get(i, j) = typename Types::Value{typename Types::Real{payoffs[i][j]}};
+        }
+    }
+    const double expl = math::exploitability(payoff_matrix, row_strategy, col_strategy);
+    assert(expl < .05);
+
+    typename Types::Value value;
+    bandit.get_empirical_value(stats, value);
+    assert(std::abs(value.get_row_value() - 1.0 / 3) < .05);
+}
+
+int main()
+{
+    test_convergence<false>();
+    test_convergence<true>();
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <pinyon.hh>
+
+/*
+
+Check that the scheduler brings every root to exactly its budget, reports each root once,
+and coalesces the leaves of all roots into shared inference calls.
+
+*/
+
+int main()
+{
+    using Types = SearchScheduler<Exp3<MonteCarloModel<MoldState<>>>>;
+
+    const size_t n_roots = 32;
+    const size_t batch_size = 8;
+
+    Types::PRNG device{0};
+    Types::Model model{0};
+    Types::Search search{{{}, batch_size}, 4};
+
+    size_t max_budget = 0;
+    for (size_t i = 0; i < n_roots; ++i)
+    {
+        const size_t budget = 1 << (6 + i % 4);
+        max_budget = std::max(max_budget, budget);
+        search.add_root(Types::State{3, 10}, budget, device);
+    }
+
+    std::vector<int> reported(n_roots, 0);
+    const size_t inference_calls = search.run(
+        model,
+        [&reported](const size_t index, Types::Root &root)
+        {
+            assert(root.iterations == root.budget);
+            ++reported[index];
+        });
+
+    for (size_t i = 0; i < n_roots; ++i)
+    {
+        const Types::Root &root = search.get_root(i);
+        assert(reported[i] == 1);
+        assert(root.matrix_node.count_matrix_nodes() == root.budget);
+    }
+
+    // one call per round, and the longest search needs about max_budget / batch_size rounds
+    assert(inference_calls < 2 * max_budget / batch_size);
+
+    std::cout << search << " : " << inference_calls << " inference calls" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <pinyon.hh>
+
+/*
+
+Check that SearchModel with a tree cache continues the tree of a repeated state,
+reuses the subtree of a child state, and that copies of the model do not share trees.
+Also that NodePool recycles node memory, and that SearchModel builds each tree from the last one's nodes, except for multithreaded searches.
+
+*/
+
+template <template <typename...> typename NodePair>
+void test_tree_cache()
+{
+    using SearchTypes = TreeBandit<Exp3<MonteCarloModel<HashRandomTree<>>>, NodePair>;
+    using Types = SearchModel<SearchTypes, true, true, true, true, true, 8>;
+    const size_t iterations = 1 << 8;
+    typename Types::Model model{iterations, prng{0}, typename SearchTypes::Model{prng{0}}, {}};
+    const typename Types::State state{prng{0}, 4, 2, 2, 2};
+
+    typename Types::ModelOutput output;
+    model.inference(typename Types::State{state}, output);
+    assert(model.trees.entries.size() > 1);
+    auto root = model.trees.find(state.get_hash());
+    assert(root != nullptr);
+    const size_t nodes = root->count_matrix_nodes();
+
+    // the same state continues the same tree
+    model.inference(typename Types::State{state}, output);
+    assert(model.trees.find(state.get_hash()) == root);
+    assert(root->count_matrix_nodes() > nodes);
+
+    // a child state continues its subtree
+    typename Types::State child{state};
+    child.randomize_transition(0);
+    child.apply_actions(0, 0);
+    auto child_node = model.trees.find(child.get_hash());
+    assert(child_node != nullptr);
+    const size_t child_nodes = child_node->count_matrix_nodes();
+    model.inference(std::move(child), output);
+    assert(child_node->count_matrix_nodes() > child_nodes);
+
+    // at most 8 entries, and a copy starts with none
+    assert(model.trees.entries.size() <= 8);
+    typename Types::Model model_copy{model};
+    assert(model_copy.trees.entries.empty());
+
+    // the root is kept alive by the cache alone
+    root.reset();
+    child_node.reset();
+    for (const auto &entry : model.trees.entries)
+    {
+        assert(entry.node->count_matrix_nodes() > 0);
+    }
+}
+
+template <template <typename...> typename NodePair>
+void test_node_pool()
+{
+    using SearchTypes = TreeBandit<Exp3<MonteCarloModel<HashRandomTree<>>>, NodePair>;
+    using MatrixNode = typename SearchTypes::MatrixNode;
+    using ChanceNode = typename SearchTypes::ChanceNode;
+
+    // a deleted node is handed out again while the pool is in use, and not otherwise
+    NodePool<MatrixNode> pool{};
+    MatrixNode *node = new MatrixNode{};
+    {
+        typename NodePool<MatrixNode>::Use use{pool};
+        delete node;
+        assert(pool.size() == 1);
+        assert(new MatrixNode{} == node);
+        assert(pool.size() == 0);
+        delete node;
+    }
+    node = new MatrixNode{};
+    delete node;
+    assert(pool.size() == 1);
+
+    const size_t iterations = 1 << 10;
+    using Types = SearchModel<SearchTypes>;
+    typename Types::Model model{iterations, prng{0}, typename SearchTypes::Model{prng{0}}, {}};
+    const typename Types::State state{prng{0}, 6, 2, 2, 2};
+    typename Types::ModelOutput output;
+
+    // the root is on the stack, so the pools hold every other node of the first tree
+    model.inference(typename Types::State{state}, output);
+    const size_t matrix_nodes = model.pools.matrix_nodes.size();
+    const size_t chance_nodes = model.pools.chance_nodes.size();
+    assert(matrix_nodes > 0 && chance_nodes > 0);
+
+    // a tree of about the same size is built from those, rather than adding to them
+    model.inference(typename Types::State{state}, output);
+    assert(model.pools.matrix_nodes.size() < matrix_nodes * 3 / 2);
+    assert(model.pools.chance_nodes.size() < chance_nodes * 3 / 2);
+
+    typename Types::ModelBatchInput batch_input{};
+    typename Types::ModelBatchOutput batch_output{};
+    for (int i = 0; i < 3; ++i)
+    {
+        model.add_to_batch_input(typename Types::State{state}, batch_input);
+    }
+    model.inference(batch_input, batch_output);
+    model.inference(batch_input, batch_output);
+    assert(batch_output.size() == 3);
+}
+
+void test_threaded_node_pool()
+{
+    // worker threads allocate from the heap, so the pools are not used at all
+    using SearchTypes = TreeBanditThreaded<Exp3<MonteCarloModel<HashRandomTree<>>>>;
+    using Types = SearchModel<SearchTypes>;
+    static_assert(!Types::use_node_pools);
+    typename Types::Model model{1 << 10, prng{0}, typename SearchTypes::Model{prng{0}}, {{}, 2}};
+    const typename Types::State state{prng{0}, 6, 2, 2, 2};
+    typename Types::ModelOutput output;
+    model.inference(typename Types::State{state}, output);
+    assert(model.pools.matrix_nodes.size() == 0);
+    assert(model.pools.chance_nodes.size() == 0);
+}
+
+int main()
+{
+    test_tree_cache<DefaultNodes>();
+    test_tree_cache<FlatNodes>();
+    test_node_pool<DefaultNodes>();
+    test_node_pool<FlatNodes>();
+    test_threaded_node_pool();
+    return 0;
+}
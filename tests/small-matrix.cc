@@ -0,0 +1,157 @@
+#include <pinyon.hh>
+
+/*
+
+Check that SmallMatrix keeps entries inline up to its capacity and on the heap beyond it,
+that copies and moves of either keep the entries, the in-place operators,
+and that bandit stats are stored in it when the type list uses it.
+
+*/
+
+using M = SmallMatrix<3>::Matrix<double>;
+
+static_assert(IsMatrix<M, double>);
+static_assert(std::is_nothrow_move_constructible_v<M> && std::is_nothrow_move_assignable_v<M>);
+static_assert(std::is_same_v<DataMatrixOf<SimpleTypes, int>::type, DataMatrix<int>>);
+
+using SmallTypes = DefaultTypes<
+    double,
+    int,
+    int,
+    double,
+    ConstantSum<1, 1>::Value,
+    std::vector,
+    SmallMatrix<4>::template Matrix>;
+
+static_assert(IsTypeList<SmallTypes>);
+
+void fill_range(M &matrix, size_t rows, size_t cols)
+{
+    matrix.fill(rows, cols);
+    for (size_t i = 0; i < matrix.size(); ++i)
+    {
+        matrix[i] = i;
+    }
+}
+
+bool is_range(const M &matrix)
+{
+    for (size_t i = 0; i < matrix.size(); ++i)
+    {
+        if (matrix[i] != i)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_storage()
+{
+    M matrix{};
+    fill_range(matrix, 3, 3);
+    assert(matrix.is_inline() && matrix.size() == 9 && is_range(matrix));
+    assert(matrix.get(2, 1) == 7);
+
+    // spills to the heap, keeping the entries in memory order and value-initializing the rest
+    matrix.fill(4, 4);
+    assert(!matrix.is_inline() && matrix.size() == 16);
+    for (size_t i = 0; i < 9; ++i)
+    {
+        assert(matrix[i] == i);
+    }
+    for (size_t i = 9; i < 16; ++i)
+    {
+        assert(matrix[i] == 0);
+    }
+
+    // a smaller shape keeps the heap storage
+    matrix.fill(2, 2, 1.0);
+    assert(!matrix.is_inline() && matrix.size() == 4 && matrix.max() == 1);
+}
+
+void test_copy_move()
+{
+    for (const size_t n : {2, 5})
+    {
+        M matrix{};
+        fill_range(matrix, n, n);
+        const bool is_inline = n <= 3;
+        assert(matrix.is_inline() == is_inline);
+
+        M copy{matrix};
+        assert(copy.is_inline() == is_inline && copy.rows == n && copy.cols == n && is_range(copy));
+        assert(copy.data() != matrix.data());
+
+        M assigned{};
+        fill_range(assigned, 4, 4);
+        assigned = matrix;
+        assert(assigned.size() == n * n && is_range(assigned));
+
+        const double *heap_data = matrix.data();
+        M moved{std::move(matrix)};
+        assert(moved.is_inline() == is_inline && moved.size() == n * n && is_range(moved));
+        if (!is_inline)
+        {
+            // the heap storage is taken rather than copied
+            assert(moved.data() == heap_data);
+            assert(matrix.size() == 0 && matrix.is_inline());
+        }
+
+        M move_assigned{};
+        move_assigned = std::move(moved);
+        assert(move_assigned.is_inline() == is_inline && move_assigned.size() == n * n && is_range(move_assigned));
+    }
+}
+
+void test_operators()
+{
+    for (const size_t n : {2, 5})
+    {
+        M a{}, b{};
+        fill_range(a, n, n);
+        fill_range(b, n, n);
+        a *= 2.0;
+        a += 1.0;
+        a += b;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            assert(a[i] == 3 * i + 1);
+        }
+        const M c = b * 2.0 + b;
+        assert(c.size() == n * n && c[1] == 3);
+        assert(c.min() == 0 && c.max() == 3 * (n * n - 1));
+    }
+}
+
+void test_bandit_stats()
+{
+    using Types = Exp3Fat<MonteCarloModel<HashRandomTree<SmallTypes>>>;
+    using SearchTypes = TreeBandit<Types>;
+    static_assert(std::is_same_v<
+                  decltype(Types::MatrixStats::matrix),
+                  SmallMatrix<4>::Matrix<Types::Data>>);
+
+    const SearchTypes::State state{prng{0}, 5, 3, 3, 1};
+    SearchTypes::Model model{prng{0}};
+    SearchTypes::Search search{};
+    SearchTypes::MatrixNode root{};
+    prng device{0};
+    search.run_for_iterations(1 << 10, device, state, model, root);
+    assert(root.stats.matrix.is_inline() && root.stats.matrix.size() == 9);
+    double count = 0;
+    for (const auto &data : root.stats.matrix)
+    {
+        count += data.count;
+    }
+    assert(count > 0);
+}
+
+int main()
+{
+    test_storage();
+    test_copy_move();
+    test_operators();
+    test_bandit_stats();
+    return 0;
+}
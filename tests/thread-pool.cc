@@ -0,0 +1,96 @@
+#include <pinyon.hh>
+
+/*
+
+Check that ThreadPool visits every index once, also with several calling threads, and that the batched inference of
+MonteCarloModel and SearchModel gives the same output for any number of threads.
+
+*/
+
+void test_parallel_for()
+{
+    for (const size_t threads : {1, 3})
+    {
+        ThreadPool pool{threads};
+        for (const size_t n : {0, 1, 2, 100})
+        {
+            std::vector<std::atomic<int>> visits(n);
+            pool.parallel_for(n, [&](const size_t i)
+                              { visits[i].fetch_add(1); });
+            for (const auto &v : visits)
+            {
+                assert(v.load() == 1);
+            }
+        }
+    }
+}
+
+// calls from several threads at once must all complete, the late ones inline
+void test_concurrent_callers()
+{
+    ThreadPool pool{3};
+    std::atomic<size_t> visits{0};
+    std::vector<std::thread> callers{};
+    for (int t = 0; t < 4; ++t)
+    {
+        callers.emplace_back([&]()
+                             {
+                                 for (int k = 0; k < 100; ++k)
+                                 {
+                                     pool.parallel_for(10, [&](const size_t)
+                                                       { visits.fetch_add(1); });
+                                 } });
+    }
+    for (auto &caller : callers)
+    {
+        caller.join();
+    }
+    assert(visits.load() == 4 * 100 * 10);
+}
+
+template <typename Types, typename F>
+double batch_value(F &&make_model, const typename Types::State &state, const size_t batch_size)
+{
+    typename Types::Model model = make_model();
+    typename Types::ModelBatchInput batch_input(batch_size, state);
+    typename Types::ModelBatchOutput batch_output;
+    model.inference(batch_input, batch_output);
+    assert(batch_output.size() == batch_size);
+    double total = 0;
+    for (const auto &output : batch_output)
+    {
+        total += output.value.get_row_value();
+    }
+    return total;
+}
+
+void test_deterministic_batches()
+{
+    using MonteCarlo = MonteCarloModel<HashRandomTree<>>;
+    using Search = SearchModel<TreeBandit<Exp3<MonteCarlo>>>;
+    const MonteCarlo::State state{prng{0}, 6, 3, 3, 2};
+
+    const double mc = batch_value<MonteCarlo>([]()
+                                              { return MonteCarlo::Model{prng{1}}; },
+                                              state, 64);
+    const double search = batch_value<Search>([]()
+                                              { return Search::Model{1 << 6, prng{1}, MonteCarlo::Model{prng{0}}, {}}; },
+                                              state, 16);
+    for (const size_t threads : {1, 2, 4})
+    {
+        assert(mc == batch_value<MonteCarlo>([threads]()
+                                             { return MonteCarlo::Model{prng{1}, threads}; },
+                                             state, 64));
+        assert(search == batch_value<Search>([threads]()
+                                             { return Search::Model{1 << 6, prng{1}, MonteCarlo::Model{prng{0}}, {}, threads}; },
+                                             state, 16));
+    }
+}
+
+int main()
+{
+    test_parallel_for();
+    test_concurrent_callers();
+    test_deterministic_batches();
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <pinyon.hh>
+
+/*
+
+Force each of the TimeManaged stopping rules with budgets in iterations.
+Every search is deterministic, so each run is compared against the same run with the rule disabled.
+
+*/
+
+const size_t chunk = 1 << 8;
+const size_t budget = 1 << 14;
+
+template <typename Types>
+size_t run(const typename Types::State &state, const typename Types::Settings &settings)
+{
+    typename Types::Search search{typename Types::Search{}, settings};
+    typename Types::Model model{prng{0}};
+    typename Types::MatrixNode root{};
+    prng device{0};
+    const size_t iterations = search.run_for_iteration_budget(budget, device, state, model, root);
+    assert(root.stats.row_visits.size() > 0);
+    assert(iterations % chunk == 0);
+    return iterations;
+}
+
+// all payoffs are the same, so the strategies stay close to uniform and there is never a lead
+void test_stability()
+{
+    using Types = TimeManaged<TreeBandit<Exp3<MonteCarloModel<MoldState<>>>>>;
+    const Types::State state{3, 2};
+
+    Types::Settings settings{};
+    settings.chunk_iterations = chunk;
+    settings.strategy_tolerance = .05;
+    const size_t stable = run<Types>(state, settings);
+    assert(stable >= budget * settings.min_fraction);
+    assert(stable < budget);
+
+    settings.strategy_tolerance = 0;
+    assert(run<Types>(state, settings) == budget);
+}
+
+// the first row and column actions dominate
+void test_lead()
+{
+    using Types = TimeManaged<TreeBandit<Exp3<MonteCarloModel<OneSumMatrixGame>>>>;
+    Types::State state{prng{0}, 3, 3};
+    for (size_t row_idx = 0; row_idx < 3; ++row_idx)
+    {
+        for (size_t col_idx = 0; col_idx < 3; ++col_idx)
+        {
+            const double row_payoff = .5 + (row_idx == 0) * .4 - (col_idx == 0) * .4;
+            state.payoff_matrix.get(row_idx, col_idx) = Types::Value{row_payoff, 1 - row_payoff};
+        }
+    }
+
+    Types::Settings settings{};
+    settings.chunk_iterations = chunk;
+    settings.strategy_tolerance = 0;
+    const size_t lead = run<Types>(state, settings);
+    assert(lead >= budget * settings.min_fraction);
+    assert(lead < budget);
+
+    // the lead is not checked before min_fraction of the budget
+    settings.min_fraction = 1;
+    assert(run<Types>(state, settings) == budget);
+}
+
+void test_empirical_matrix()
+{
+    using Types = TimeManaged<TreeBandit<Exp3Fat<MonteCarloModel<MoldState<RandomTreeFloatTypes>>>>>;
+    Types::Search search{};
+    Types::MatrixStats stats{};
+    stats.matrix.fill(2, 2);
+    // only the upper triangle is stored. entries below the diagonal are for the column player
+    stats.matrix.get(0, 0) = {1, 2};
+    stats.matrix.get(0, 1) = {3, 4};
+    stats.matrix.get(1, 0) = {0, 0};
+
+    DataMatrix<PairReal<Types::Real>> value_matrix{};
+    assert(search.get_empirical_matrix(stats, value_matrix));
+    assert(value_matrix.rows == 2 && value_matrix.cols == 2);
+    assert(value_matrix.get(0, 0).get_row_value() == .5);
+    assert(value_matrix.get(0, 1).get_row_value() == .75);
+    assert(value_matrix.get(1, 0).get_row_value() == .25);
+    assert(value_matrix.get(1, 0).get_col_value() == .75);
+    // unvisited entries are a draw
+    assert(value_matrix.get(1, 1).get_row_value() == .5);
+
+    stats.matrix.fill(2, 3);
+    assert(!search.get_empirical_matrix(stats, value_matrix));
+}
+
+// the strategies settle quickly, but are only accepted once they are not too exploitable
+void test_exploitability()
+{
+    using Types = TimeManaged<TreeBandit<Exp3Fat<MonteCarloModel<MoldState<RandomTreeFloatTypes>>>>>;
+    const Types::State state{3, 2};
+
+    Types::Settings settings{};
+    settings.chunk_iterations = chunk;
+    settings.strategy_tolerance = .05;
+    settings.max_exploitability = .1;
+    // every payoff is a draw, so any strategy is unexploitable
+    assert(run<Types>(state, settings) < budget);
+
+    settings.max_exploitability = -1;
+    assert(run<Types>(state, settings) == budget);
+}
+
+void test_extension()
+{
+    using Types = TimeManaged<TreeBandit<Exp3<MonteCarloModel<MoldState<>>>>>;
+    const Types::State state{3, 2};
+
+    Types::Settings settings{};
+    settings.chunk_iterations = chunk;
+    settings.min_fraction = 1;
+    settings.max_extension = 1;
+
+    // never settled, so the search runs to the end of the extension
+    settings.strategy_tolerance = 0;
+    assert(run<Types>(state, settings) == 2 * budget);
+
+    // settled by the end of the budget, so it is not extended
+    settings.strategy_tolerance = .05;
+    assert(run<Types>(state, settings) == budget);
+
+    settings.max_extension = 0;
+    settings.strategy_tolerance = 0;
+    assert(run<Types>(state, settings) == budget);
+}
+
+int main()
+{
+    test_stability();
+    test_lead();
+    test_empirical_matrix();
+    test_exploitability();
+    test_extension();
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <pinyon.hh>
+
+/*
+
+Check that the transition tables of the flat searches key on the whole action indices,
+so transitions that differ only in large row or col indices get different children.
+
+*/
+
+using Types = Exp3<MonteCarloModel<MoldState<>>>;
+
+void test_flat()
+{
+    TreeBanditFlat<Types>::TransitionTable table{16};
+    table(0, 1, 0, 0) = 1;
+    uint32_t &child = table(0, 0, 1 << 16, 0);
+    assert(child == 0);
+    child = 2;
+    table(1, 0, 0, 0) = 3;
+
+    // still found after the table grows
+    for (uint32_t parent = 2; parent < 64; ++parent)
+    {
+        table(parent, 0, 0, 0) = parent + 2;
+    }
+    assert(table.get_capacity() > 16);
+    assert(table(0, 1, 0, 0) == 1);
+    assert(table(0, 0, 1 << 16, 0) == 2);
+    assert(table(1, 0, 0, 0) == 3);
+    assert(table.get_size() == 65);
+}
+
+void test_threaded()
+{
+    using Table = TreeBanditFlatThreaded<Types>::TransitionTable;
+    Table table{16};
+    std::atomic<uint32_t> counter{1};
+    assert(table(0, 1, 0, 0, counter, 16) == 1);
+    assert(table(0, 0, 1 << 16, 0, counter, 16) == 2);
+    assert(table(0, 1 << 16, 0, 0, counter, 16) == 3);
+    assert(table(0, 1, 0, 0, counter, 16) == 1);
+    assert(table(0, 0, 1 << 16, 0, counter, 16) == 2);
+}
+
+int main()
+{
+    test_flat();
+    test_threaded();
+    return 0;
+}
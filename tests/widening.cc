@@ -0,0 +1,203 @@
+#include <pinyon.hh>
+
+/*
+
+Check that progressive widening limits the number of active actions at the root,
+and that the action strategies are reported in the state's action order.
+Bandits with per joint action stats must keep them by (row, col) when widening grows them.
+Actions are widened in order of their priors, or in their own order if the policy does not cover them.
+
+*/
+
+template <template <typename...> typename NodePair>
+void test_widening()
+{
+    using Widening = ProgressiveWidening<1, 1, 1, 2>;
+    using Types = TreeBandit<Exp3<MonteCarloModel<MoldState<>, true>>, NodePair, SearchOptions<void, void, void, void, 1 << 10, 1 << 4, Widening>>;
+
+    const size_t actions = 20;
+    const size_t iterations = 1 << 8;
+
+    typename Types::PRNG device{0};
+    typename Types::State state{actions, 10};
+    typename Types::Model model{0};
+    typename Types::MatrixNode root{};
+    typename Types::Search search{};
+
+    search.run_for_iterations(iterations, device, state, model, root);
+
+    // the first iteration expands the root, the rest visit it
+    const size_t active = Widening::get_active_actions(iterations - 1, actions);
+    assert(active < actions);
+    assert(root.stats.active_rows == active && root.stats.active_cols == active);
+
+    typename Types::VectorReal row_strategy, col_strategy;
+    search.get_action_strategies(root.stats, row_strategy, col_strategy);
+    assert(row_strategy.size() == actions && col_strategy.size() == actions);
+    double row_sum = 0, col_sum = 0;
+    size_t row_support = 0;
+    for (size_t i = 0; i < actions; ++i)
+    {
+        row_sum += math::to_double(row_strategy[i]);
+        col_sum += math::to_double(col_strategy[i]);
+        row_support += math::to_double(row_strategy[i]) > 0;
+    }
+    assert(std::abs(row_sum - 1) < 1e-6 && std::abs(col_sum - 1) < 1e-6);
+    assert(row_support <= active);
+
+    std::cout << search << " : " << active << " active actions" << std::endl;
+}
+
+template <typename Types>
+double sum(const typename Types::VectorReal &strategy)
+{
+    double total = 0;
+    for (const auto &x : strategy)
+    {
+        total += math::to_double(x);
+    }
+    return total;
+}
+
+template <typename Types>
+void test_expand_keeps_entries()
+{
+    typename Types::BanditAlgorithm bandit{};
+    typename Types::MatrixStats stats{};
+    bandit.expand(stats, 2, 2, {});
+    typename Types::Outcome outcome{};
+    outcome.row_idx = 1;
+    outcome.col_idx = 1;
+    outcome.value = typename Types::Value{typename Types::Real{1}};
+    bandit.update_matrix_stats(stats, outcome);
+    bandit.expand(stats, 3, 4, {});
+    assert(stats.data_matrix.rows == 3 && stats.data_matrix.cols == 4);
+    for (size_t i = 0; i < 3; ++i)
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            assert(stats.data_matrix.get(i, j).visits == (i == 1 && j == 1));
+        }
+    }
+    assert(std::abs(sum<Types>(stats.row_strategy) - 1) < 1e-9);
+    assert(std::abs(sum<Types>(stats.col_strategy) - 1) < 1e-9);
+}
+
+void test_exp3_fat_expand_keeps_entries()
+{
+    using Types = Exp3Fat<MonteCarloModel<MoldState<RandomTreeFloatTypes>>>;
+    Types::BanditAlgorithm bandit{};
+    Types::MatrixStats stats{};
+    bandit.expand(stats, 2, 2, {});
+    Types::Outcome outcome{};
+    outcome.row_idx = 0;
+    outcome.col_idx = 1;
+    outcome.row_mu = outcome.col_mu = .5;
+    outcome.value = Types::Value{Types::Real{1}};
+    bandit.update_matrix_stats(stats, outcome);
+    bandit.expand(stats, 3, 3, {});
+    assert(stats.matrix.get(0, 1).count == 1);
+    assert(stats.matrix.get(1, 0).count == 0);
+}
+
+// the root's per entry visits still add up to its total visits after widening
+void test_matrix_ucb_search()
+{
+    using Widening = ProgressiveWidening<1, 1, 1, 2>;
+    using Types = TreeBandit<MatrixUCB<MonteCarloModel<MoldState<RandomTreeFloatTypes>>>, DefaultNodes, SearchOptions<void, void, void, void, 1 << 10, 1 << 4, Widening>>;
+    Types::PRNG device{0};
+    Types::State state{6, 2};
+    Types::Model model{0};
+    Types::MatrixNode root{};
+    Types::Search search{};
+    search.run_for_iterations(1 << 6, device, state, model, root);
+    assert(root.stats.active_rows > 1);
+    int visits = 0;
+    for (const auto &data : root.stats.data_matrix)
+    {
+        visits += data.visits;
+    }
+    assert(visits == root.stats.total_visits);
+}
+
+// MonteCarloModel with a policy that favours later actions, or that is cut short
+template <bool short_policy>
+struct PolicyModel : MonteCarloModel<MoldState<>, true>
+{
+    using Base = MonteCarloModel<MoldState<>, true>;
+
+    class Model : public Base::Model
+    {
+    public:
+        using Base::Model::Model;
+
+        void inference(State &&state, ModelOutput &output)
+        {
+            const size_t rows = state.row_actions.size();
+            const size_t cols = state.col_actions.size();
+            Base::Model::inference(std::move(state), output);
+            if constexpr (short_policy)
+            {
+                output.row_policy.clear();
+                output.col_policy.resize(cols / 2);
+                return;
+            }
+            const double total = rows * (rows + 1) / 2.0;
+            for (size_t i = 0; i < rows; ++i)
+            {
+                output.row_policy[i] = (i + 1) / total;
+                output.col_policy[i] = (i + 1) / total;
+            }
+        }
+    };
+};
+
+template <bool short_policy>
+void test_priors()
+{
+    using Widening = ProgressiveWidening<1, 1, 1, 2>;
+    using Types = TreeBandit<PUCT<PolicyModel<short_policy>>, DefaultNodes, SearchOptions<void, void, void, void, 1 << 10, 1 << 4, Widening>>;
+    const size_t actions = 9;
+    typename Types::PRNG device{0};
+    typename Types::State state{actions, 3};
+    typename Types::Model model{prng{0}};
+    typename Types::MatrixNode root{};
+    typename Types::Search search{};
+
+    search.run_for_iterations(4, device, state, model, root);
+    const auto &stats = root.stats;
+    assert(stats.rows == actions && stats.active_rows < actions);
+    // the bandit's priors, in bandit index order
+    assert(stats.row_priors.size() == stats.active_rows);
+    if constexpr (short_policy)
+    {
+        // the rows are widened in the state's order, with uniform priors
+        assert(stats.row_order.empty() && stats.sorted_row_priors.empty());
+        assert(stats.row_priors[0] == 1.0f / stats.active_rows);
+        assert(stats.col_order.empty());
+    }
+    else
+    {
+        assert(stats.row_order[0] == actions - 1 && stats.col_order[1] == actions - 2);
+        assert(stats.sorted_row_priors.size() == actions);
+        assert(stats.row_priors[0] == static_cast<float>(actions / (actions * (actions + 1) / 2.0)));
+    }
+
+    // once every action is active the priors are freed
+    search.run_for_iterations(1 << 8, device, state, model, root);
+    assert(root.stats.active_rows == actions && root.stats.active_cols == actions);
+    assert(root.stats.sorted_row_priors.empty() && root.stats.sorted_col_priors.empty());
+}
+
+int main()
+{
+    test_widening<DefaultNodes>();
+    test_widening<FlatNodes>();
+    test_expand_keeps_entries<MatrixUCB<MonteCarloModel<MoldState<RandomTreeFloatTypes>>>>();
+    test_expand_keeps_entries<MatrixUCBIncremental<MonteCarloModel<MoldState<RandomTreeFloatTypes>>>>();
+    test_exp3_fat_expand_keeps_entries();
+    test_matrix_ucb_search();
+    test_priors<false>();
+    test_priors<true>();
+    return 0;
+}